@@ -0,0 +1,471 @@
+#include "StdAfx.h"
+#include "DNAStatement.h"
+#include "EvaluatingFunction.h"
+#include "ThreadPool.h"
+#include "CaseTable.h"
+#include ".\batchrun.h"
+
+
+//Settings a specification may sweep, in the column order of the summary
+enum SWEEPKEY{
+	SWEEP_POPULATIONSIZE = 0,
+	SWEEP_SELECTIONSIZE,
+	SWEEP_TOURNAMENTSIZE,
+	SWEEP_MAXDEPTH,
+	SWEEP_CROSSMAXDEPTH,
+	SWEEP_TREEDENSITY,
+	SWEEP_MUTPROB,
+	SWEEP_CASECOUNT,
+	SWEEP_DATAFILE,
+	SWEEP_XCOLUMNS,
+	SWEEP_YCOLUMN,
+	SWEEP_STREAMBUDGET,
+	SWEEP_STEADYSTATE,
+	SWEEP_PIPELINED,
+	SWEEP_SEED,
+	SWEEP_GENERATIONS,
+	SWEEP_TIMEBUDGET,
+	SWEEP_NODEBUDGET,
+	SWEEP_CASEBUDGET,
+	SWEEP_WORKERS,
+	SWEEPKEYCOUNT
+};
+
+static const TCHAR* SweepKeys[SWEEPKEYCOUNT] = {
+	_T("PopulationSize"), _T("SelectionSize"), _T("TournamentSize"), _T("MaxDepth"),
+	_T("CrossMaxDepth"), _T("TreeDensity"), _T("MutProb"), _T("CaseCount"),
+	_T("DataFile"), _T("XColumns"), _T("YColumn"), _T("StreamBudget"),
+	_T("SteadyState"), _T("Pipelined"), _T("Seed"), _T("Generations"), _T("TimeBudget"), _T("NodeBudget"), _T("CaseBudget"),
+	_T("Workers")
+};
+
+//What the values of a setting are
+enum SWEEPVALUE{
+	VALUE_WHOLE = 0,		//whole numbers, and ranges of them
+	VALUE_REAL,				//numbers
+	VALUE_SWITCH,			//0 or 1
+	VALUE_TEXT,				//a file name
+	VALUE_COLUMNS			//whole numbers apart by spaces, one per input
+};
+
+static const SWEEPVALUE SweepValues[SWEEPKEYCOUNT] = {
+	VALUE_WHOLE, VALUE_WHOLE, VALUE_WHOLE, VALUE_WHOLE,
+	VALUE_WHOLE, VALUE_WHOLE, VALUE_REAL, VALUE_WHOLE,
+	VALUE_TEXT, VALUE_COLUMNS, VALUE_WHOLE, VALUE_WHOLE,
+	VALUE_SWITCH, VALUE_SWITCH, VALUE_WHOLE, VALUE_WHOLE, VALUE_REAL, VALUE_REAL, VALUE_REAL,
+	VALUE_WHOLE
+};
+
+static bool parseNumber(const CString& Token, bool Whole, double& Value){
+	//The whole token has to be a finite number, not below 0
+	LPCTSTR Beg = Token;
+	LPTSTR End = NULL;
+	Value = _tcstod(Beg, &End);
+	if((End == Beg) || *End) return false;
+	if(!(Value - Value == 0.0f) || (Value < 0.0f)) return false;
+	if(Whole && ((Value != floor(Value)) || (Value > (double)INT_MAX))) return false;
+	return true;
+}
+
+static COUNTER parseColumns(const CString& Token, COUNTER* Columns){
+	//Number of columns read, 0 if one is not a whole number or there are too many
+	COUNTER Count = 0;
+	int Pos = 0;
+	CString Column = Token.Tokenize(_T(" \t"), Pos);
+	while(!Column.IsEmpty()){
+		double Value;
+		if((Count == MAXVARIABLES) || !parseNumber(Column, true, Value)) return 0;
+		Columns[Count++] = (COUNTER)Value;
+		Column = Token.Tokenize(_T(" \t"), Pos);
+	}
+	return Count;
+}
+
+static void checkValue(COUNTER Key, const CString& Token, const CString& Where){
+	double Value;
+	COUNTER Columns[MAXVARIABLES];
+	switch(SweepValues[Key]){
+		case VALUE_WHOLE:
+			if(!parseNumber(Token, true, Value))
+				throw CString(_T("Not a whole number: ")) + Token + Where;
+			break;
+		case VALUE_REAL:
+			if(!parseNumber(Token, false, Value))
+				throw CString(_T("Not a number of 0 or more: ")) + Token + Where;
+			break;
+		case VALUE_SWITCH:
+			if(!parseNumber(Token, true, Value) || (Value > 1.0f))
+				throw CString(_T("Not 0 or 1: ")) + Token + Where;
+			break;
+		case VALUE_TEXT:
+			if(Token.GetLength() >= MAX_PATH)
+				throw CString(_T("File name too long: ")) + Token + Where;
+			break;
+		case VALUE_COLUMNS:
+			if(!parseColumns(Token, Columns))
+				throw CString(_T("Not a list of input columns: ")) + Token + Where;
+			break;
+	}
+}
+
+static void applySetting(CSweepRun& R, COUNTER Key, const CString& Token){
+	//Values were checked as the specification was read
+	double Value = 0.0f;
+	if((SweepValues[Key] == VALUE_WHOLE) || (SweepValues[Key] == VALUE_REAL) || (SweepValues[Key] == VALUE_SWITCH))
+		parseNumber(Token, false, Value);
+	COUNTER Whole = (COUNTER)Value;
+	switch(Key){
+		case SWEEP_POPULATIONSIZE:	R.Run.PopulationSize = Whole; break;
+		case SWEEP_SELECTIONSIZE:	R.Run.SelectionSize = Whole; break;
+		case SWEEP_TOURNAMENTSIZE:	R.Run.TournamentSize = Whole; break;
+		case SWEEP_MAXDEPTH:		R.Run.MaxDepth = Whole; break;
+		case SWEEP_CROSSMAXDEPTH:	R.Run.CrossMaxDepth = Whole; break;
+		case SWEEP_TREEDENSITY:		R.Run.TreeDensity = Whole; break;
+		case SWEEP_MUTPROB:			R.Run.MutProb = Value; break;
+		case SWEEP_CASECOUNT:		R.Run.CaseCount = Whole; break;
+		case SWEEP_DATAFILE:		lstrcpyn(R.Run.DataFile, Token, MAX_PATH); break;
+		case SWEEP_XCOLUMNS:		R.Run.VariableCount = parseColumns(Token, R.Run.XColumns); break;
+		case SWEEP_YCOLUMN:			R.Run.YColumn = Whole; break;
+		case SWEEP_STREAMBUDGET:	R.Run.StreamBudget = Whole; break;
+		case SWEEP_STEADYSTATE:		R.Run.SteadyState = (Whole != 0); break;
+		case SWEEP_PIPELINED:		R.Run.Pipelined = (Whole != 0); break;
+		case SWEEP_SEED:			R.Run.RunSeed = Whole; break;
+		case SWEEP_GENERATIONS:		R.Generations = Whole; break;
+		case SWEEP_TIMEBUDGET:		R.Run.TimeBudget = Value; break;
+		case SWEEP_NODEBUDGET:		R.Run.NodeBudget = Value; break;
+		case SWEEP_CASEBUDGET:		R.Run.CaseBudget = Value; break;
+		case SWEEP_WORKERS:			R.Run.WorkerCount = Whole; break;
+	}
+}
+
+static CString csvField(const CString& Text){
+	//Quoted, with inner quotes doubled
+	CString Field(Text);
+	Field.Replace(_T("\""), _T("\"\""));
+	return _T("\"") + Field + _T("\"");
+}
+
+static CString settingText(const CSweepRun& R, COUNTER Key){
+	//As the summary shows it
+	CString Text;
+	switch(Key){
+		case SWEEP_POPULATIONSIZE:	Text.Format("%d", R.Run.PopulationSize); break;
+		case SWEEP_SELECTIONSIZE:	Text.Format("%d", R.Run.SelectionSize); break;
+		case SWEEP_TOURNAMENTSIZE:	Text.Format("%d", R.Run.TournamentSize); break;
+		case SWEEP_MAXDEPTH:		Text.Format("%d", R.Run.MaxDepth); break;
+		case SWEEP_CROSSMAXDEPTH:	Text.Format("%d", R.Run.CrossMaxDepth); break;
+		case SWEEP_TREEDENSITY:		Text.Format("%d", R.Run.TreeDensity); break;
+		case SWEEP_MUTPROB:			Text.Format("%g", R.Run.MutProb); break;
+		case SWEEP_CASECOUNT:		Text.Format("%d", R.Run.CaseCount); break;
+		case SWEEP_DATAFILE:		Text = csvField(R.Run.DataFile); break;
+		case SWEEP_XCOLUMNS:{
+				CString Columns;
+				for(COUNTER v=0; (v<R.Run.VariableCount)&&(R.Run.DataFile[0]); v++){
+					CString Column;
+					Column.Format(v ? " %d" : "%d", R.Run.XColumns[v]);
+					Columns += Column;
+				}
+				Text = csvField(Columns);
+				break;
+			}
+		case SWEEP_YCOLUMN:			Text.Format("%d", R.Run.YColumn); break;
+		case SWEEP_STREAMBUDGET:	Text.Format("%d", R.Run.StreamBudget); break;
+		case SWEEP_STEADYSTATE:		Text = R.Run.SteadyState ? _T("1") : _T("0"); break;
+		case SWEEP_PIPELINED:		Text = R.Run.Pipelined ? _T("1") : _T("0"); break;
+		case SWEEP_SEED:			Text.Format("%d", R.Run.RunSeed); break;
+		case SWEEP_GENERATIONS:		Text.Format("%d", R.Generations); break;
+		case SWEEP_TIMEBUDGET:		Text.Format("%g", R.Run.TimeBudget); break;
+		case SWEEP_NODEBUDGET:		Text.Format("%g", R.Run.NodeBudget); break;
+		case SWEEP_CASEBUDGET:		Text.Format("%g", R.Run.CaseBudget); break;
+		case SWEEP_WORKERS:			Text.Format("%d", R.Run.WorkerCount); break;
+	}
+	return Text;
+}
+
+
+CSweepRun::CSweepRun():
+Generations(DEFAULTSWEEPGENERATIONS), Generation(0), BestFitness(INFINITY_GRADE), BestHits(0),
+TotalNormalizedFitness(0.0f), Seconds(0.0f){
+}
+
+
+/*******************************
+Sweep task: one configuration, run
+to its last generation or budget on
+a worker.
+*******************************/
+class CSweepTask : public CPoolTask
+{
+	CSweepRun& Sweep;
+
+public:
+	CSweepTask(CSweepRun& S): Sweep(S){};
+
+	void run(COUNTER Worker){
+		unsigned __int64 Start = CThreadPool::getTicks();
+		CThreadPool* Pool = NULL;
+		try{
+			//Batches run inline, the pool being busy with the other runs,
+			//unless the run asks for its own workers
+			if(Sweep.Run.WorkerCount) Pool = new CThreadPool(Sweep.Run.WorkerCount);
+			CPopulation P(Sweep.Run, Pool);
+			P.setRunning(true);
+			while(P.isRunning() && (P.getGeneration() < Sweep.Generations))
+				P.step();
+			if(P.isRunning())
+				P.evaluate(false);
+			else{
+				static const TCHAR* Budgets[] = { _T(""), _T("time"), _T("node"), _T("case") };
+				Sweep.Stopped = Budgets[P.EvalFunc->getBudgetSpent()];
+			}
+
+			Sweep.Generation = P.getGeneration();
+			Sweep.TotalNormalizedFitness = P.Summary.TotalNormalizedFitness;
+			if(P.getBestSoFar()){
+				CDNAStatement Best(*(P.getBestSoFar()));
+				Sweep.BestFitness = Best.Fitness->getStandardizedFitness();
+				Sweep.BestHits = Best.Fitness->getHits();
+				Sweep.Best = Best.toString();
+			}
+		}
+		catch(CString Mssg){
+			Sweep.Error = Mssg;
+		}
+		if(Pool) delete Pool;
+		Sweep.Seconds = (double)(CThreadPool::getTicks() - Start)/CThreadPool::getTickFrequency();
+	}
+};
+
+
+/*******************************
+Specification Methods
+*******************************/
+CBatchRun::CBatchRun(const CString& SpecFile){
+
+	CStdioFile Spec;
+	if(!Spec.Open(SpecFile, CFile::modeRead | CFile::typeText))
+		throw CString(_T("Could not open the sweep specification ")) + SpecFile;
+
+	vector< vector<CString> > Values(SWEEPKEYCOUNT);
+	try{
+		CString Line;
+		COUNTER LineNumber = 0;
+		while(Spec.ReadString(Line)){
+			LineNumber++;
+			int Comment = Line.FindOneOf(_T(";#"));
+			if(Comment >= 0) Line = Line.Left(Comment);
+			Line.Trim();
+			if(Line.IsEmpty()) continue;
+
+			CString Where;
+			Where.Format(" at line %d of the sweep specification", LineNumber);
+
+			int Equals = Line.Find(_T('='));
+			if(Equals < 0) throw CString(_T("Missing '='")) + Where;
+			CString Key = Line.Left(Equals);
+			Key.Trim();
+
+			COUNTER k = 0;
+			while((k < SWEEPKEYCOUNT) && Key.CompareNoCase(SweepKeys[k])) k++;
+			if(k == SWEEPKEYCOUNT) throw CString(_T("Unknown setting ")) + Key + Where;
+
+			int Pos = 0;
+			CString List = Line.Mid(Equals + 1);
+			CString Token = List.Tokenize(_T(","), Pos);
+			while(!Token.IsEmpty()){
+				Token.Trim();
+				int Range = (SweepValues[k] == VALUE_WHOLE) ? Token.Find(_T("..")) : -1;
+				if(Range >= 0){
+					CString From = Token.Left(Range), To = Token.Mid(Range + 2);
+					From.Trim();
+					To.Trim();
+					double First, Last;
+					if(!parseNumber(From, true, First) || !parseNumber(To, true, Last))
+						throw CString(_T("Not a range of whole numbers: ")) + Token + Where;
+					if(Last < First) throw CString(_T("Empty range ")) + Token + Where;
+					if(Last - First >= MAXSWEEPRUNS) throw CString(_T("Range too long: ")) + Token + Where;
+					for(double v=First; v<=Last; v++){
+						CString Value;
+						Value.Format("%.0f", v);
+						Values[k].push_back(Value);
+					}
+				}
+				else if(!Token.IsEmpty()){
+					checkValue(k, Token, Where);
+					Values[k].push_back(Token);
+				}
+				Token = List.Tokenize(_T(","), Pos);
+			}
+			if(Values[k].empty()) throw CString(_T("No values")) + Where;
+		}
+	}
+	catch(CException* e){
+		e->Delete();
+		throw CString(_T("Could not read the sweep specification ")) + SpecFile;
+	}
+
+	expand(Values);
+}
+
+void CBatchRun::expand(const vector< vector<CString> >& Values){
+	//Every combination, the last setting varying fastest; unlisted settings keep their defaults
+	unsigned __int64 Count = 1;
+	for(COUNTER k=0; k<SWEEPKEYCOUNT; k++)
+		if(Values[k].size()) Count *= Values[k].size();
+	if(Count > MAXSWEEPRUNS) throw CString(_T("The sweep specification expands to too many runs\r\n"));
+
+	vector<COUNTER> Digit(SWEEPKEYCOUNT, 0);
+	for(COUNTER r=0; r<Count; r++){
+		CSweepRun R;
+		for(COUNTER k=0; k<SWEEPKEYCOUNT; k++)
+			if(Values[k].size()) applySetting(R, k, Values[k][Digit[k]]);
+		Runs.push_back(R);
+
+		for(int k=SWEEPKEYCOUNT-1; k>=0; k--){
+			if(Values[k].empty()) continue;
+			if(++Digit[k] < Values[k].size()) break;
+			Digit[k] = 0;
+		}
+	}
+}
+
+
+/*******************************
+Run Methods
+*******************************/
+static bool cheaperRun(const CSweepRun* A, const CSweepRun* B){
+	return (double)A->Run.PopulationSize*A->Run.CaseCount*A->Generations
+		< (double)B->Run.PopulationSize*B->Run.CaseCount*B->Generations;
+}
+
+void CBatchRun::run(CThreadPool& Pool){
+
+	//Workers start on the newest task of their own deque, so the cheapest
+	//runs are queued first and the longest ones start right away
+	vector<CSweepRun*> Order;
+	for(COUNTER r=0; r<Runs.size(); r++)
+		Order.push_back(&Runs[r]);
+	stable_sort(Order.begin(), Order.end(), cheaperRun);
+
+	//Tables are opened here rather than by the runs, so every run of a file
+	//finds the one read-only copy already in the cache of CCaseTable. A file
+	//that fails to open is left to its runs to report.
+	vector<CCaseTable*> Tables;
+	for(COUNTER r=0; r<Runs.size(); r++){
+		const CRunSettings& S = Runs[r].Run;
+		if(!S.DataFile[0]) continue;
+		try{
+			Tables.push_back(CCaseTable::open(S.DataFile, S.XColumns, S.VariableCount, S.YColumn, S.StreamBudget > 0));
+		}
+		catch(CString){
+		}
+	}
+
+	vector<CSweepTask*> Tasks;
+	for(COUNTER r=0; r<Order.size(); r++)
+		Tasks.push_back(new CSweepTask(*Order[r]));
+
+	CTaskGroup Batch(Pool);
+	for(COUNTER t=0; t<Tasks.size(); t++)
+		Batch.run(Tasks[t]);
+	try{
+		Batch.wait();
+	}
+	catch(CString){
+		//Runs keep their own errors
+	}
+
+	for(COUNTER t=0; t<Tasks.size(); t++)
+		delete Tasks[t];
+	for(COUNTER t=0; t<Tables.size(); t++)
+		CCaseTable::release(Tables[t]);
+}
+
+static bool comparableRun(const CSweepRun& R){
+	//Steady-state runs and runs a budget may stop midway end
+	//differently on different workers
+	return !R.Run.SteadyState && R.Error.IsEmpty() &&
+		!R.Run.TimeBudget && !R.Run.NodeBudget && !R.Run.CaseBudget;
+}
+
+COUNTER CBatchRun::checkWorkers(){
+	//Every run is compared with the first run of the sweep that differs from
+	//it only in Workers. Returns the number of runs that did not end alike
+	COUNTER Differ = 0;
+	for(COUNTER r=0; r<Runs.size(); r++){
+		CSweepRun& R = Runs[r];
+		if(!comparableRun(R)) continue;
+
+		for(COUNTER s=0; s<r; s++){
+			const CSweepRun& S = Runs[s];
+			COUNTER k = 0;
+			while((k < SWEEP_WORKERS) && (settingText(R, k) == settingText(S, k))) k++;
+			if((k < SWEEP_WORKERS) || !comparableRun(S)) continue;
+
+			bool Same = (R.Generation == S.Generation) && (R.BestFitness == S.BestFitness) &&
+				(R.BestHits == S.BestHits) && (R.TotalNormalizedFitness == S.TotalNormalizedFitness) &&
+				(R.Best == S.Best);
+			R.WorkerCheck.Format(Same ? "same as row %d" : "DIFFERS from row %d", s + 1);
+			if(!Same) Differ++;
+			break;
+		}
+	}
+	return Differ;
+}
+
+void CBatchRun::writeSummary(const CString& File) const{
+
+	CStdioFile Out;
+	if(!Out.Open(File, CFile::modeCreate | CFile::modeWrite | CFile::typeText))
+		throw CString(_T("Could not create the sweep summary ")) + File;
+
+	try{
+		CString Line;
+		for(COUNTER k=0; k<SWEEPKEYCOUNT; k++)
+			Line += CString(SweepKeys[k]) + _T(",");
+		Line += _T("Generation,BestFitness,BestHits,TotalNormalizedFitness,Seconds,Stopped,Best,WorkerCheck,Error\n");
+		Out.WriteString(Line);
+
+		for(COUNTER r=0; r<Runs.size(); r++){
+			const CSweepRun& R = Runs[r];
+			Line.Empty();
+			for(COUNTER k=0; k<SWEEPKEYCOUNT; k++)
+				Line += settingText(R, k) + _T(",");
+			CString Outcome;
+			Outcome.Format("%d,%.6f,%d,%.6f,%.3f,",
+				R.Generation, R.BestFitness, R.BestHits, R.TotalNormalizedFitness, R.Seconds);
+			Line += Outcome + R.Stopped + _T(",") + csvField(R.Best) + _T(",") + R.WorkerCheck + _T(",") + csvField(R.Error) + _T("\n");
+			Out.WriteString(Line);
+		}
+		Out.Close();
+	}
+	catch(CException* e){
+		e->Delete();
+		throw CString(_T("Could not write the sweep summary ")) + File;
+	}
+}
+
+int CBatchRun::runBatch(const CString& SpecFile, const CString& SummaryFile){
+	//No window to report to: a bad sweep leaves its reason in the summary file.
+	//Returns 1 if so, 2 if runs differing only in Workers did not end alike
+	COUNTER Differ = 0;
+	try{
+		CBatchRun Batch(SpecFile);
+		Batch.run(*CThreadPool::getShared());
+		Differ = Batch.checkWorkers();
+		Batch.writeSummary(SummaryFile);
+	}
+	catch(CString Mssg){
+		CStdioFile Out;
+		if(Out.Open(SummaryFile, CFile::modeCreate | CFile::modeWrite | CFile::typeText)){
+			try{
+				Out.WriteString(_T("Error\n") + csvField(Mssg) + _T("\n"));
+			}
+			catch(CException* e){
+				e->Delete();
+			}
+		}
+		return 1;
+	}
+	return Differ ? 2 : 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Population.h"
+
+#define MAXSWEEPRUNS 4096
+//Largest number of runs a sweep specification may expand to
+
+#define DEFAULTSWEEPGENERATIONS 50
+//Generations of every run when the specification does not say
+
+class CThreadPool;
+
+
+/*******************************
+One configuration of a sweep and
+what its run came to.
+*******************************/
+struct CSweepRun{
+	CRunSettings Run;
+	COUNTER Generations;
+
+	COUNTER Generation;					//reached
+	double BestFitness;					//standardized
+	COUNTER BestHits;
+	double TotalNormalizedFitness;
+	double Seconds;
+	CString Stopped;					//budget that ended the run early, if any
+	CString Best;
+	CString Error;						//empty if the run finished
+	CString WorkerCheck;				//against the first run differing only in Workers
+
+	CSweepRun();
+};
+
+
+/*******************************
+Headless parameter sweep, started with
+/batch <specification> <summary.csv>.
+The specification gives the values of
+one setting a line, ranges of whole
+numbers as a..b:
+
+	PopulationSize = 300, 600
+	MutProb = 0.1, 0.2
+	Seed = 1..10
+	Generations = 100
+	TimeBudget = 30
+	Pipelined = 0, 1
+	Workers = 1, 64
+	DataFile = cases.csv
+	XColumns = 0 1, 2
+	YColumn = 3
+
+Budgets are in seconds, node and case
+evaluations, 0 for none; a run stopped by
+one reports its best so far. SteadyState
+and Pipelined are 0 or 1. XColumns lists
+the input columns of a run apart by spaces.
+Every run of a data file reads the one copy
+of it the batch opens.
+
+Every combination is run, all at once
+on the shared pool: a run is one task and
+its population grades inline on the worker
+that took it, or on a pool of its own when
+Workers is set. One CSV row per run.
+
+Runs that differ only in Workers end
+alike, steady-state runs and runs with a
+budget aside. The WorkerCheck column
+compares each run with the first such row;
+runBatch returns 2 if one did not match.
+Code/Checks holds sweeps that cover the
+ways a population grades.
+*******************************/
+class CBatchRun
+{
+	vector<CSweepRun> Runs;
+
+	void expand(const vector< vector<CString> >& Values);
+
+public:
+	CBatchRun(const CString& SpecFile);			//throws CString on a bad specification
+	void run(CThreadPool& Pool);
+	COUNTER checkWorkers();						//runs that ended unlike their match
+	void writeSummary(const CString& File) const;
+
+	COUNTER getRunCount() const { return (COUNTER)Runs.size(); };
+	static int runBatch(const CString& SpecFile, const CString& SummaryFile);		//body of /batch
+};
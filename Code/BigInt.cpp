@@ -0,0 +1,132 @@
+#include "StdAfx.h"
+#include ".\bigint.h"
+
+
+/*******************************
+Admin Methods
+*******************************/
+CBigInt::CBigInt(int v):
+Negative(v < 0){
+	unsigned int a = (v < 0) ? (unsigned int)(-(v+1)) + 1 : (unsigned int)v;
+	if(a) Mag.push_back(a);
+}
+
+CBigInt::CBigInt(double v):
+Negative(v < 0.0f){
+	//v must hold an integer value
+	double a = floor(fabs(v) + 0.5f);
+	while(a >= 1.0f){
+		double Word = fmod(a, 4294967296.0);
+		Mag.push_back((unsigned int)Word);
+		a = floor(a / 4294967296.0);
+	}
+	trim();
+}
+
+void CBigInt::trim(){
+	while(Mag.size() && !Mag.back())
+		Mag.pop_back();
+	if(Mag.empty()) Negative = false;
+}
+
+
+/*******************************
+Magnitude Helpers
+*******************************/
+int CBigInt::compareMag(const vector<unsigned int>& A, const vector<unsigned int>& B){
+	if(A.size() != B.size()) return (A.size() < B.size()) ? -1 : 1;
+	for(COUNTER i = (COUNTER)A.size(); i > 0; i--)
+		if(A[i-1] != B[i-1]) return (A[i-1] < B[i-1]) ? -1 : 1;
+	return 0;
+}
+
+void CBigInt::addMag(const vector<unsigned int>& A, const vector<unsigned int>& B, vector<unsigned int>& Res){
+	const vector<unsigned int>& L = (A.size() >= B.size()) ? A : B;
+	const vector<unsigned int>& S = (A.size() >= B.size()) ? B : A;
+	Res.resize(L.size());
+
+	unsigned __int64 Carry = 0;
+	for(COUNTER i=0; i<L.size(); i++){
+		unsigned __int64 Sum = (unsigned __int64)L[i] + Carry;
+		if(i < S.size()) Sum += S[i];
+		Res[i] = (unsigned int)Sum;
+		Carry = Sum >> 32;
+	}
+	if(Carry) Res.push_back((unsigned int)Carry);
+}
+
+void CBigInt::subMag(const vector<unsigned int>& A, const vector<unsigned int>& B, vector<unsigned int>& Res){
+	//|A| >= |B|
+	Res.resize(A.size());
+
+	unsigned int Borrow = 0;
+	for(COUNTER i=0; i<A.size(); i++){
+		unsigned __int64 Sub = (unsigned __int64)Borrow;
+		if(i < B.size()) Sub += B[i];
+		if((unsigned __int64)A[i] >= Sub){
+			Res[i] = (unsigned int)((unsigned __int64)A[i] - Sub);
+			Borrow = 0;
+		}
+		else{
+			Res[i] = (unsigned int)(((unsigned __int64)1 << 32) + A[i] - Sub);
+			Borrow = 1;
+		}
+	}
+}
+
+
+/*******************************
+Arithmetic
+*******************************/
+CBigInt CBigInt::operator-() const{
+	CBigInt Res(*this);
+	if(!Res.isZero()) Res.Negative = !Negative;
+	return Res;
+}
+
+CBigInt CBigInt::operator+(const CBigInt& B) const{
+	CBigInt Res;
+	if(Negative == B.Negative){
+		addMag(Mag, B.Mag, Res.Mag);
+		Res.Negative = Negative;
+	}
+	else if(compareMag(Mag, B.Mag) >= 0){
+		subMag(Mag, B.Mag, Res.Mag);
+		Res.Negative = Negative;
+	}
+	else{
+		subMag(B.Mag, Mag, Res.Mag);
+		Res.Negative = B.Negative;
+	}
+	Res.trim();
+	return Res;
+}
+
+CBigInt CBigInt::operator-(const CBigInt& B) const{
+	return (*this) + (-B);
+}
+
+CBigInt CBigInt::operator*(const CBigInt& B) const{
+	CBigInt Res;
+	if(isZero() || B.isZero()) return Res;
+
+	Res.Mag.resize(Mag.size() + B.Mag.size(), 0);
+	for(COUNTER i=0; i<Mag.size(); i++){
+		unsigned __int64 Carry = 0;
+		for(COUNTER j=0; j<B.Mag.size(); j++){
+			unsigned __int64 Cur = (unsigned __int64)Mag[i]*B.Mag[j] + Res.Mag[i+j] + Carry;
+			Res.Mag[i+j] = (unsigned int)Cur;
+			Carry = Cur >> 32;
+		}
+		COUNTER k = i + (COUNTER)B.Mag.size();
+		while(Carry){
+			unsigned __int64 Cur = (unsigned __int64)Res.Mag[k] + Carry;
+			Res.Mag[k] = (unsigned int)Cur;
+			Carry = Cur >> 32;
+			k++;
+		}
+	}
+	Res.Negative = (Negative != B.Negative);
+	Res.trim();
+	return Res;
+}
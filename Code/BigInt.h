@@ -0,0 +1,33 @@
+#pragma once
+
+/*******************************
+Signed integer of arbitrary size,
+magnitude stored in base 2^32,
+least significant word first.
+Only what exact polynomial
+arithmetic needs: +, -, *, ==.
+*******************************/
+class CBigInt
+{
+	vector<unsigned int> Mag;
+	bool Negative;
+
+	void trim();
+	static int compareMag(const vector<unsigned int>& A, const vector<unsigned int>& B);
+	static void addMag(const vector<unsigned int>& A, const vector<unsigned int>& B, vector<unsigned int>& Res);
+	static void subMag(const vector<unsigned int>& A, const vector<unsigned int>& B, vector<unsigned int>& Res);
+
+public:
+	CBigInt(int v = 0);
+	CBigInt(double v);
+
+	bool isZero() const { return Mag.empty(); };
+	bool isNegative() const { return Negative; };
+
+	CBigInt operator-() const;
+	CBigInt operator+(const CBigInt& B) const;
+	CBigInt operator-(const CBigInt& B) const;
+	CBigInt operator*(const CBigInt& B) const;
+	bool operator==(const CBigInt& B) const { return (Negative == B.Negative) && (Mag == B.Mag); };
+	bool operator!=(const CBigInt& B) const { return !(*this == B); };
+};
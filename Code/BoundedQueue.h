@@ -0,0 +1,46 @@
+#pragma once
+
+/*******************************
+Fixed-capacity queue between two
+stages run on the same pool workers.
+It never blocks: a full queue tells
+the producer to go and consume
+instead, so no worker can wait on
+a stage that no one is running.
+*******************************/
+template <class T>
+class CBoundedQueue
+{
+	vector<T> Ring;
+	COUNTER Head, Count;
+	CCriticalSection Lock;
+
+public:
+	CBoundedQueue(COUNTER Capacity):
+	Ring(Capacity ? Capacity : 1), Head(0), Count(0){};
+
+	bool tryPush(const T& Item){
+		bool Pushed = false;
+		Lock.Lock();
+		if(Count < Ring.size()){
+			Ring[(Head + Count) % Ring.size()] = Item;
+			Count++;
+			Pushed = true;
+		}
+		Lock.Unlock();
+		return Pushed;
+	}
+
+	bool tryPop(T& Item){
+		bool Popped = false;
+		Lock.Lock();
+		if(Count){
+			Item = Ring[Head];
+			Head = (Head + 1) % Ring.size();
+			Count--;
+			Popped = true;
+		}
+		Lock.Unlock();
+		return Popped;
+	}
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#define CASEALIGN 64
+//Bytes every column of fitness cases is aligned to: a cache line, and the widest vector load
+
+
+/*******************************
+Columns of fitness cases, column-major
+in one block. Every column starts on a
+CASEALIGN boundary, and so does every
+PLANBLOCK of it, so the evaluation
+kernels run over aligned vectors.
+*******************************/
+class CCaseColumns
+{
+	double* Block;
+	COUNTER Rows;
+	COUNTER Columns;
+	COUNTER Stride;						//doubles from a column to the next
+
+	CCaseColumns(const CCaseColumns&);
+	const CCaseColumns& operator=(const CCaseColumns&);
+
+public:
+	CCaseColumns(): Block(NULL), Rows(0), Columns(0), Stride(0){};
+	~CCaseColumns(){ clear(); };
+
+	void resize(COUNTER RowCount, COUNTER ColumnCount){
+		//Throws CString; the values are left uninitialized
+		clear();
+		if(!RowCount || !ColumnCount) return;
+		COUNTER Lane = CASEALIGN/sizeof(double);
+		Stride = (RowCount + Lane - 1)/Lane*Lane;
+		Block = (double*)_aligned_malloc((size_t)Stride*ColumnCount*sizeof(double), CASEALIGN);
+		if(!Block) throw CString(_T("Out of memory for the fitness cases at CCaseColumns::resize\r\n"));
+		Rows = RowCount;
+		Columns = ColumnCount;
+	};
+
+	void clear(){
+		if(Block) _aligned_free(Block);
+		Block = NULL;
+		Rows = Columns = Stride = 0;
+	};
+
+	COUNTER getRowCount() const { return Rows; };
+	COUNTER getColumnCount() const { return Columns; };
+	double* getColumn(COUNTER c){ return Block + (size_t)c*Stride; };
+	const double* getColumn(COUNTER c) const { return Block + (size_t)c*Stride; };
+};
@@ -0,0 +1,104 @@
+#include "StdAfx.h"
+#include "EvalPlan.h"
+#include "CaseTable.h"
+#include ".\casestream.h"
+
+
+/*******************************
+Admin Methods
+*******************************/
+CCaseStream::CCaseStream(const CCaseTable& T, unsigned __int64 BudgetBytes):
+Table(T), BufferRows(0), Free(STREAMBUFFERS, STREAMBUFFERS), Filled(0, STREAMBUFFERS),
+Taken(0), Stopping(false), Reader(NULL){
+
+	//Buffers hold whole plan blocks, and no more rows than the file has
+	COUNTER Columns = Table.getVariableCount() + 1;
+	unsigned __int64 Rows = BudgetBytes/((unsigned __int64)STREAMBUFFERS*Columns*sizeof(double));
+	unsigned __int64 FileRows = (Table.getStreamRows() + PLANBLOCK - 1)/PLANBLOCK*PLANBLOCK;
+	if(Rows > FileRows) Rows = FileRows;
+	if(Rows > 0x7FFFFFFF) Rows = 0x7FFFFFFF;
+	BufferRows = (COUNTER)Rows/PLANBLOCK*PLANBLOCK;
+	if(!BufferRows) throw CString(_T("The stream budget cannot hold a block of fitness cases at CCaseStream construction\r\n"));
+
+	for(COUNTER b=0; b<STREAMBUFFERS; b++){
+		Ring[b].Columns.resize(BufferRows, Columns);
+		Ring[b].Rows = 0;
+		for(COUNTER v=0; v<Table.getVariableCount(); v++)
+			Ring[b].X[v] = Ring[b].Columns.getColumn(v);
+		Ring[b].Y = Ring[b].Columns.getColumn(Columns - 1);
+	}
+
+	if(!In.Open(Table.getFile(), CFile::modeRead | CFile::shareDenyNone | CFile::typeBinary))
+		throw CString(_T("Could not open the fitness cases ")) + Table.getFile();
+
+	Reader = AfxBeginThread(ReaderProc, this, THREAD_PRIORITY_NORMAL, 0, CREATE_SUSPENDED);
+	if(!Reader){
+		In.Close();
+		throw CString(_T("Could not start the case reader at CCaseStream construction\r\n"));
+	}
+	Reader->m_bAutoDelete = FALSE;
+	Reader->ResumeThread();
+}
+
+CCaseStream::~CCaseStream(){
+	//A reader waiting for a buffer wakes up to stop; one reading stops after it
+	Stopping = true;
+	Free.Unlock();
+	WaitForSingleObject(Reader->m_hThread, INFINITE);
+	delete Reader;
+	In.Close();
+}
+
+
+/*******************************
+Reader Methods
+*******************************/
+UINT CCaseStream::ReaderProc(LPVOID Param){
+	((CCaseStream*)Param)->read();
+	return 0;
+}
+
+void CCaseStream::read(){
+
+	//Buffers are filled in ring order; one of no rows ends the stream,
+	//after the last row or on a failure
+	unsigned __int64 Total = Table.getStreamRows();
+	unsigned __int64 First = 0;
+	COUNTER Slot = 0;
+	for(;;){
+		Free.Lock();
+		if(Stopping) return;
+
+		CCaseBuffer& B = Ring[Slot];
+		COUNTER Count = (Total - First < BufferRows) ? (COUNTER)(Total - First) : BufferRows;
+		try{
+			if(Count) Table.readRows(In, First, Count, B.Columns);
+		}
+		catch(CString Mssg){
+			Failure = Mssg;
+			Count = 0;
+		}
+		B.Rows = Count;
+		First += Count;
+		Slot = (Slot + 1) % STREAMBUFFERS;
+		Filled.Unlock();
+		if(!Count) return;
+	}
+}
+
+
+/*******************************
+Caller Methods
+*******************************/
+const CCaseBuffer* CCaseStream::next(){
+	Filled.Lock();
+	const CCaseBuffer& B = Ring[Taken % STREAMBUFFERS];
+	if(B.Rows) return &B;
+	if(!Failure.IsEmpty()) throw Failure;
+	return NULL;
+}
+
+void CCaseStream::release(){
+	Taken++;
+	Free.Unlock();
+}
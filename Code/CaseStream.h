@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CaseColumns.h"
+
+#define STREAMBUFFERS 3
+//Row buffers of a case stream: one scored, one being read and one ready in between
+
+class CCaseTable;
+
+/*******************************
+Rows of a streamed case file in a
+buffer, column by column: the inputs,
+then the target.
+*******************************/
+struct CCaseBuffer
+{
+	CCaseColumns Columns;
+	COUNTER Rows;						//0 past the last row
+	const double* X[MAXVARIABLES];
+	const double* Y;
+};
+
+
+/*******************************
+Fitness cases read from a streamed
+binary case file, buffer by buffer,
+once from the first row to the last.
+A reader thread fills a ring of
+STREAMBUFFERS buffers ahead of the
+caller, so the disk is read while the
+buffer before is scored. The ring is
+allocated once and never holds more
+than the budget it was given.
+*******************************/
+class CCaseStream
+{
+	const CCaseTable& Table;
+	COUNTER BufferRows;
+	CCaseBuffer Ring[STREAMBUFFERS];
+	CSemaphore Free;					//buffers the reader may fill
+	CSemaphore Filled;					//buffers the caller may take
+	COUNTER Taken;						//by the caller
+	volatile bool Stopping;
+	CString Failure;					//of the reader, set before its last buffer
+	CFile In;
+	CWinThread* Reader;
+
+	static UINT ReaderProc(LPVOID Param);
+	void read();
+
+	CCaseStream(const CCaseStream&);
+	const CCaseStream& operator=(const CCaseStream&);
+
+public:
+	CCaseStream(const CCaseTable& T, unsigned __int64 BudgetBytes);	//throws CString
+	~CCaseStream();
+
+	const CCaseBuffer* next();			//waits for the next buffer, NULL past the last row; throws CString
+	void release();						//hands the buffer next returned back to the reader
+
+	COUNTER getBufferRows() const { return BufferRows; };
+};
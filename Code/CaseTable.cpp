@@ -0,0 +1,871 @@
+#include "StdAfx.h"
+#include "ThreadPool.h"
+#include ".\casetable.h"
+
+
+CCriticalSection CCaseTable::CacheLock;
+vector<CCaseTable*> CCaseTable::Cache;
+
+static const char CaseFileMagic[8] = "SRCASES";
+
+static const double Pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/*******************************
+Parsing
+*******************************/
+static bool parseNumber(const char* Beg, const char* End, double& Value){
+	//Clinger's fast path: up to 15 significant digits and a power of ten up
+	//to 10^22 are exact doubles, so one multiply or divide rounds correctly.
+	//Longer or stranger numbers go to strtod.
+	while((Beg < End) && ((*Beg == ' ') || (*Beg == '"'))) Beg++;
+	while((End > Beg) && ((End[-1] == ' ') || (End[-1] == '"'))) End--;
+	if(Beg == End) return false;
+
+	const char* p = Beg;
+	bool Negative = (*p == '-');
+	if((*p == '-') || (*p == '+')) p++;
+
+	unsigned __int64 Mantissa = 0;
+	int Digits = 0;
+	int Exponent = 0;
+	bool HasDigits = false;
+	for(; (p < End) && (*p >= '0') && (*p <= '9'); p++){
+		HasDigits = true;
+		if(Digits < 19){
+			Mantissa = Mantissa*10 + (*p - '0');
+			if(Mantissa) Digits++;
+		}
+		else{
+			Exponent++;
+			Digits++;
+		}
+	}
+	if((p < End) && (*p == '.')){
+		for(p++; (p < End) && (*p >= '0') && (*p <= '9'); p++){
+			HasDigits = true;
+			if(Digits < 19){
+				Mantissa = Mantissa*10 + (*p - '0');
+				if(Mantissa) Digits++;
+				Exponent--;
+			}
+			else Digits++;
+		}
+	}
+	if(HasDigits && (p < End) && ((*p == 'e') || (*p == 'E'))){
+		p++;
+		bool NegativeExponent = (p < End) && (*p == '-');
+		if((p < End) && ((*p == '-') || (*p == '+'))) p++;
+		int Power = 0;
+		HasDigits = false;
+		for(; (p < End) && (*p >= '0') && (*p <= '9'); p++){
+			HasDigits = true;
+			if(Power < 100000) Power = Power*10 + (*p - '0');
+		}
+		Exponent += NegativeExponent ? -Power : Power;
+	}
+
+	if(HasDigits && (p == End) && (Digits <= 15) && (Exponent >= -22) && (Exponent <= 22)){
+		Value = (double)(__int64)Mantissa;
+		Value = (Exponent < 0) ? Value / Pow10[-Exponent] : Value * Pow10[Exponent];
+		if(Negative) Value = -Value;
+		return true;
+	}
+
+	//strtod also reads inf and nan, but only finite numbers make fitness cases
+	char Field[CSVMAXFIELD];
+	if(End - Beg >= CSVMAXFIELD) return false;
+	memcpy(Field, Beg, End - Beg);
+	Field[End - Beg] = 0;
+	char* Stop;
+	Value = strtod(Field, &Stop);
+	return (Stop != Field) && (*Stop == 0) && (Value - Value == 0.0f);
+}
+
+static const char* fieldEnd(const char* p, const char* Eol, char Separator){
+	//Quoted fields may hold separators
+	if((p < Eol) && (*p == '"')){
+		for(p++; p < Eol; p++)
+			if(*p == '"'){
+				if((p + 1 < Eol) && (p[1] == '"')) p++;
+				else{
+					p++;
+					break;
+				}
+			}
+	}
+	while((p < Eol) && (*p != Separator)) p++;
+	return p;
+}
+
+static COUNTER readFields(const char* Line, const char* Eol, char Separator, COUNTER Count, double* Fields){
+	//Reads the first Count fields of a line, NaN for any without a number,
+	//and returns how many held one
+	COUNTER Numbers = 0;
+	const char* p = Line;
+	for(COUNTER f=0; f<Count; f++){
+		const char* Field = p;
+		if(p <= Eol) p = fieldEnd(p, Eol, Separator);
+		if((Field <= Eol) && parseNumber(Field, p, Fields[f])) Numbers++;
+		else Fields[f] = numeric_limits<double>::quiet_NaN();
+		p++;
+	}
+	return Numbers;
+}
+
+static COUNTER countFields(const char* Line, const char* Eol, char Separator){
+	COUNTER Count = 1;
+	for(const char* p = fieldEnd(Line, Eol, Separator); p < Eol; p = fieldEnd(p + 1, Eol, Separator))
+		Count++;
+	return Count;
+}
+
+static const char* nextLine(const char* Pos, const char* End){
+	const char* Eol = (const char*)memchr(Pos, '\n', End - Pos);
+	return Eol ? Eol + 1 : End;
+}
+
+static const char* lineEnd(const char* Line, const char* Next){
+	//End of the text of a line, without its line break
+	if((Next > Line) && (Next[-1] == '\n')) Next--;
+	if((Next > Line) && (Next[-1] == '\r')) Next--;
+	return Next;
+}
+
+
+static char findSeparator(const char* Line, const char* Next){
+	for(const char* p = Line; p < Next; p++)
+		if((*p == ',') || (*p == ';') || (*p == '\t'))
+			return *p;
+	return ',';
+}
+
+static bool isHeader(const char* Line, const char* Eol, char Separator, COUNTER& Numbers){
+	//The first line of a CSV file is a header when one of its fields, read or
+	//not, holds text other than a number; a blank field does not tell. Numbers
+	//counts the fields that held one, so a header that may be a row is reported
+	bool Text = false;
+	Numbers = 0;
+	for(const char* p = Line; p <= Eol; p++){
+		const char* FieldEnd = fieldEnd(p, Eol, Separator);
+		double Value;
+		if(parseNumber(p, FieldEnd, Value)) Numbers++;
+		else
+			for(const char* c = p; c < FieldEnd; c++)
+				if((*c != ' ') && (*c != '"')) Text = true;
+		p = FieldEnd;
+	}
+	return Text;
+}
+
+static CString headerWarning(COUNTER Numbers){
+	CString Warning;
+	Warning.Format("\r\nThe first line was read as a header, though %d of its fields hold numbers", Numbers);
+	return Warning;
+}
+
+static const char* skipBom(const char* Beg, const char* End){
+	if((End - Beg >= 3) && ((unsigned char)Beg[0] == 0xEF) && ((unsigned char)Beg[1] == 0xBB) && ((unsigned char)Beg[2] == 0xBF))
+		return Beg + 3;
+	return Beg;
+}
+
+
+/*******************************
+Chunk task: parses a run of whole
+lines of the file into its own rows.
+*******************************/
+class CCsvChunkTask : public CPoolTask
+{
+	const char* Beg;
+	const char* End;
+	char Separator;
+	const vector<COUNTER>& Columns;
+	COUNTER FieldCount;			//read from every line, enough for all the columns
+	bool Strict;				//a missing number fails the chunk, instead of reading NaN
+
+public:
+	vector< vector<double> > Values;	//one per column
+	COUNTER Lines;				//read, blank ones included
+	bool Failed;				//on the last line read
+
+	CCsvChunkTask(const char* b, const char* e, char Sep, const vector<COUNTER>& Cols, COUNTER Fields, bool S):
+	Beg(b), End(e), Separator(Sep), Columns(Cols), FieldCount(Fields), Strict(S),
+	Values(Cols.size()), Lines(0), Failed(false){};
+
+	COUNTER getRowCount() const { return Values.size() ? (COUNTER)Values[0].size() : 0; };
+
+	void run(COUNTER Worker){
+		vector<double> Fields(FieldCount);
+		for(const char* Line = Beg; Line < End; ){
+			const char* Next = nextLine(Line, End);
+			const char* Eol = lineEnd(Line, Next);
+			Lines++;
+			if(Eol > Line){
+				readFields(Line, Eol, Separator, FieldCount, &Fields[0]);
+				for(COUNTER c=0; c<Columns.size(); c++){
+					double Value = Fields[Columns[c]];
+					if(Strict && (Value != Value)){
+						Failed = true;
+						return;
+					}
+					Values[c].push_back(Value);
+				}
+			}
+			Line = Next;
+		}
+	}
+};
+
+static void parseChunks(CThreadPool& Pool, const char* Beg, const char* End, char Separator,
+						const vector<COUNTER>& Columns, COUNTER FieldCount, bool Strict, vector<CCsvChunkTask*>& Tasks){
+	//Chunks end on line breaks, so every task parses whole lines
+	COUNTER TaskCount = (COUNTER)((End - Beg)/CSVCHUNKBYTES) + 1;
+	const char* ChunkBeg = Beg;
+	for(COUNTER t=0; (t<TaskCount) && (ChunkBeg < End); t++){
+		const char* ChunkEnd = End;
+		if(t + 1 < TaskCount){
+			ChunkEnd = Beg + (size_t)(((unsigned __int64)(End - Beg)*(t + 1))/TaskCount);
+			if(ChunkEnd < ChunkBeg) ChunkEnd = ChunkBeg;
+			ChunkEnd = nextLine(ChunkEnd, End);
+		}
+		Tasks.push_back(new CCsvChunkTask(ChunkBeg, ChunkEnd, Separator, Columns, FieldCount, Strict));
+		ChunkBeg = ChunkEnd;
+	}
+
+	CTaskGroup Batch(Pool);
+	for(COUNTER t=0; t<Tasks.size(); t++)
+		Batch.run(Tasks[t]);
+	Batch.wait();
+}
+
+
+/*******************************
+Reads a CSV file a block of whole
+lines at a time, so that a file of
+any size converts in bounded memory.
+*******************************/
+class CCsvBlocks
+{
+	CFile& In;
+	const CString& File;
+	vector<char> Buffer;
+	size_t Filled;
+	size_t Cut;					//end of the block handed out, whole lines
+	bool Ended;
+
+public:
+	CCsvBlocks(CFile& I, const CString& F):
+	In(I), File(F), Buffer(CASEFILEBLOCKBYTES), Filled(0), Cut(0), Ended(false){};
+
+	bool next(const char*& Beg, const char*& End){
+		//The partial line after the last block starts the next one
+		memmove(&Buffer[0], &Buffer[Cut], Filled - Cut);
+		Filled -= Cut;
+		Cut = 0;
+		while(!Ended && (Filled < Buffer.size())){
+			UINT Read = In.Read(&Buffer[Filled], (UINT)(Buffer.size() - Filled));
+			if(!Read) Ended = true;
+			Filled += Read;
+		}
+		if(!Filled) return false;
+
+		Cut = Filled;
+		if(!Ended){
+			while(Cut && (Buffer[Cut - 1] != '\n')) Cut--;
+			if(!Cut) throw CString(_T("A line is longer than a conversion block in ")) + File;
+		}
+		Beg = &Buffer[0];
+		End = Beg + Cut;
+		return true;
+	}
+
+	void rewind(){
+		In.SeekToBegin();
+		Filled = Cut = 0;
+		Ended = false;
+	}
+};
+
+
+/*******************************
+Admin Methods
+*******************************/
+CCaseTable::CCaseTable(const CString& F, const COUNTER* XCols, COUNTER Variables, COUNTER YCol, bool Stream):
+File(F), VariableCount(Variables), YColumn(YCol), References(0), YData(NULL), Rows(0),
+XMin(0.0f), XMax(0.0f), LoadSeconds(0.0f), FileBytes(0), HeaderNumbers(0), Mapped(false), Streamed(Stream), StreamRows(0),
+FileHandle(NULL), Mapping(NULL){
+
+	if((Variables < 1) || (Variables > MAXVARIABLES))
+		throw CString(_T("Illegal number of input columns at CCaseTable construction\r\n"));
+	for(COUNTER v=0; v<MAXVARIABLES; v++){
+		XColumns[v] = (v < Variables) ? XCols[v] : 0;
+		XData[v] = NULL;
+	}
+}
+
+bool CCaseTable::reads(const CString& F, const COUNTER* XCols, COUNTER Variables, COUNTER YCol, bool Stream) const{
+	if(File.CompareNoCase(F) || (VariableCount != Variables) || (YColumn != YCol) || (Streamed != Stream)) return false;
+	for(COUNTER v=0; v<Variables; v++)
+		if(XColumns[v] != XCols[v]) return false;
+	return true;
+}
+
+CCaseTable::~CCaseTable(){
+	for(COUNTER v=0; v<Views.size(); v++)
+		UnmapViewOfFile(Views[v]);
+	if(Mapping) CloseHandle(Mapping);
+	if(FileHandle) CloseHandle(FileHandle);
+}
+
+CCaseTable* CCaseTable::open(const CString& File, const COUNTER* XColumns, COUNTER VariableCount, COUNTER YColumn,
+							  bool Streamed){
+
+	CacheLock.Lock();
+	try{
+		for(COUNTER i=0; i<Cache.size(); i++)
+			if(Cache[i]->reads(File, XColumns, VariableCount, YColumn, Streamed)){
+				Cache[i]->References++;
+				CacheLock.Unlock();
+				return Cache[i];
+			}
+
+		//Read under the lock, so populations opening the same file at once read it once
+		CCaseTable* Table = new CCaseTable(File, XColumns, VariableCount, YColumn, Streamed);
+		try{
+			if(!isCaseFile(File)){
+				if(Streamed) throw File + _T(" is not a binary case file, only those are streamed\r\n");
+				Table->loadCsv(*CThreadPool::getShared());
+			}
+			else if(Streamed) Table->streamCases();
+			else Table->mapCases();
+		}
+		catch(CString Mssg){
+			delete Table;
+			throw Mssg;
+		}
+		Table->References = 1;
+		Cache.push_back(Table);
+		CacheLock.Unlock();
+		return Table;
+	}
+	catch(CString Mssg){
+		CacheLock.Unlock();
+		throw Mssg;
+	}
+}
+
+void CCaseTable::release(CCaseTable* Table){
+	if(!Table) return;
+	CacheLock.Lock();
+	if(!--Table->References){
+		Cache.erase(find(Cache.begin(), Cache.end(), Table));
+		delete Table;
+	}
+	CacheLock.Unlock();
+}
+
+
+/*******************************
+Load Methods
+*******************************/
+void CCaseTable::loadCsv(CThreadPool& Pool){
+
+	unsigned __int64 Start = CThreadPool::getTicks();
+
+	vector<char> Text;
+	CFile In;
+	if(!In.Open(File, CFile::modeRead | CFile::shareDenyWrite | CFile::typeBinary))
+		throw CString(_T("Could not open the fitness cases ")) + File;
+	try{
+		//A 32-bit build cannot hold the text of a file of 4 GB or more
+		ULONGLONG Length = In.GetLength();
+		if(Length != (ULONGLONG)(size_t)Length)
+			throw File + _T(" is too large to load whole: convert it to a binary case file with /convert and stream it\r\n");
+		Text.resize((size_t)Length);
+		size_t Done = 0;
+		while(Done < Text.size()){
+			size_t Part = Text.size() - Done;
+			if(Part > 16*CSVCHUNKBYTES) Part = 16*CSVCHUNKBYTES;
+			UINT Read = In.Read(&Text[Done], (UINT)Part);
+			if(!Read) break;
+			Done += Read;
+		}
+		Text.resize(Done);
+		In.Close();
+	}
+	catch(CException* e){
+		e->Delete();
+		throw CString(_T("Could not read the fitness cases ")) + File;
+	}
+	FileBytes = Text.size();
+	if(Text.empty()) throw CString(_T("No fitness cases in ")) + File;
+
+	const char* End = &Text[0] + Text.size();
+	const char* Beg = skipBom(&Text[0], End);
+
+	//The inputs, then the target
+	vector<COUNTER> Columns(XColumns, XColumns + VariableCount);
+	Columns.push_back(YColumn);
+	COUNTER FieldCount = *max_element(Columns.begin(), Columns.end()) + 1;
+
+	//The first line sets the separator, and may be a header
+	const char* Second = nextLine(Beg, End);
+	char Separator = findSeparator(Beg, Second);
+	COUNTER HeaderLines = 0;
+	COUNTER Numbers = 0;
+	if(isHeader(Beg, lineEnd(Beg, Second), Separator, Numbers)){
+		HeaderLines = 1;
+		HeaderNumbers = Numbers;
+		Beg = Second;
+	}
+
+	vector<CCsvChunkTask*> Tasks;
+	try{
+		parseChunks(Pool, Beg, End, Separator, Columns, FieldCount, true, Tasks);
+
+		//Rows in file order; a bad line is reported by its number in the file
+		COUNTER Line = HeaderLines;
+		COUNTER Count = 0;
+		for(COUNTER t=0; t<Tasks.size(); t++){
+			if(Tasks[t]->Failed){
+				CString Mssg;
+				Mssg.Format("Line %d of %s has no number in one of the columns read\r\n",
+					Line + Tasks[t]->Lines, (LPCTSTR)File);
+				throw Mssg;
+			}
+			Line += Tasks[t]->Lines;
+			Count += Tasks[t]->getRowCount();
+		}
+		if(!Count) throw CString(_T("No fitness cases in ")) + File;
+
+		Values.resize(Count, (COUNTER)Columns.size());
+		for(COUNTER c=0; c<Columns.size(); c++){
+			double* Column = Values.getColumn(c);
+			for(COUNTER t=0; t<Tasks.size(); t++){
+				if(Tasks[t]->getRowCount())
+					memcpy(Column, &Tasks[t]->Values[c][0], Tasks[t]->getRowCount()*sizeof(double));
+				Column += Tasks[t]->getRowCount();
+			}
+		}
+		Rows = Count;
+	}
+	catch(CString Mssg){
+		for(COUNTER t=0; t<Tasks.size(); t++)
+			delete Tasks[t];
+		throw Mssg;
+	}
+	for(COUNTER t=0; t<Tasks.size(); t++)
+		delete Tasks[t];
+
+	for(COUNTER v=0; v<VariableCount; v++)
+		XData[v] = Values.getColumn(v);
+	YData = Values.getColumn(VariableCount);
+	const double* X = XData[0];
+	XMin = XMax = X[0];
+	for(COUNTER i=1; i<Rows; i++){
+		if(X[i] < XMin) XMin = X[i];
+		if(X[i] > XMax) XMax = X[i];
+	}
+	LoadSeconds = (double)(CThreadPool::getTicks() - Start)/CThreadPool::getTickFrequency();
+}
+
+bool CCaseTable::isCaseFile(const CString& File){
+	CFile In;
+	if(!In.Open(File, CFile::modeRead | CFile::shareDenyNone | CFile::typeBinary))
+		return false;
+	char Magic[sizeof(CaseFileMagic)];
+	bool Is = (In.Read(Magic, sizeof(Magic)) == sizeof(Magic)) && !memcmp(Magic, CaseFileMagic, sizeof(Magic));
+	In.Close();
+	return Is;
+}
+
+void CCaseTable::openCaseFile(unsigned __int64& RowCount){
+
+	//Checks the header and keeps the descriptors of the columns in use
+	FileHandle = CreateFile(File, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(FileHandle == INVALID_HANDLE_VALUE){
+		FileHandle = NULL;
+		throw CString(_T("Could not open the fitness cases ")) + File;
+	}
+	DWORD High = 0;
+	DWORD Low = GetFileSize(FileHandle, &High);
+	FileBytes = ((unsigned __int64)High << 32) | Low;
+
+	Mapping = CreateFileMapping(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!Mapping) throw CString(_T("Could not map the fitness cases ")) + File;
+
+	CCaseFileHeader Header;
+	if(FileBytes < sizeof(Header)) throw CString(_T("Not a binary case file: ")) + File;
+	const void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, sizeof(Header));
+	if(!View) throw CString(_T("Could not map the fitness cases ")) + File;
+	Header = *(const CCaseFileHeader*)View;
+	UnmapViewOfFile(View);
+
+	CString Mssg;
+	unsigned __int64 DescriptorBytes = sizeof(Header) + (unsigned __int64)Header.ColumnCount*sizeof(CCaseFileColumn);
+	if(memcmp(Header.Magic, CaseFileMagic, sizeof(CaseFileMagic)) || (Header.Version != CASEFILEVERSION))
+		Mssg.Format("%s is a binary case file of another version\r\n", (LPCTSTR)File);
+	else if(!Header.RowCount || (Header.RowCount > FileBytes) || (DescriptorBytes > FileBytes))
+		Mssg.Format("%s is a damaged binary case file\r\n", (LPCTSTR)File);
+	else if(YColumn >= Header.ColumnCount)
+		Mssg.Format("%s has no column %d, only %d columns\r\n", (LPCTSTR)File, YColumn, Header.ColumnCount);
+	for(COUNTER v=0; v<VariableCount; v++)
+		if(Mssg.IsEmpty() && (XColumns[v] >= Header.ColumnCount))
+			Mssg.Format("%s has no column %d, only %d columns\r\n", (LPCTSTR)File, XColumns[v], Header.ColumnCount);
+	if(!Mssg.IsEmpty()) throw Mssg;
+	RowCount = Header.RowCount;
+
+	View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, (SIZE_T)DescriptorBytes);
+	if(!View) throw CString(_T("Could not map the fitness cases ")) + File;
+	const CCaseFileColumn* Descriptors = (const CCaseFileColumn*)((const char*)View + sizeof(Header));
+	Columns.clear();
+	for(COUNTER v=0; v<VariableCount; v++)
+		Columns.push_back(Descriptors[XColumns[v]]);
+	Columns.push_back(Descriptors[YColumn]);
+	UnmapViewOfFile(View);
+
+	for(COUNTER c=0; c<Columns.size(); c++)
+		checkColumn(Columns[c], RowCount);
+	XMin = Columns[0].Min;
+	XMax = Columns[0].Max;
+}
+
+void CCaseTable::checkColumn(const CCaseFileColumn& Column, unsigned __int64 RowCount) const{
+
+	char Terminated[CASEFILENAME + 1];
+	memcpy(Terminated, Column.Name, CASEFILENAME);
+	Terminated[CASEFILENAME] = 0;
+	CString Name(Terminated);
+	unsigned __int64 Width = (Column.Type == CASECOLUMN_FLOAT32) ? sizeof(float) : sizeof(double);
+	CString Mssg;
+	if(Column.Type > CASECOLUMN_FLOAT32)
+		Mssg.Format("Column %s of %s has an unknown type\r\n", (LPCTSTR)Name, (LPCTSTR)File);
+	else if(!Column.Numeric)
+		Mssg.Format("Column %s of %s does not hold a number in every row\r\n", (LPCTSTR)Name, (LPCTSTR)File);
+	else if((Column.Offset % CASEFILEALIGN) || (Column.Offset + Width*RowCount > FileBytes))
+		Mssg.Format("%s is a damaged binary case file\r\n", (LPCTSTR)File);
+	if(!Mssg.IsEmpty()) throw Mssg;
+}
+
+void CCaseTable::mapCases(){
+
+	//Only the header, the descriptors and the columns in use are mapped,
+	//and nothing is read ahead: the time taken is the same at any size
+	unsigned __int64 Start = CThreadPool::getTicks();
+	Mapped = true;
+
+	unsigned __int64 RowCount;
+	openCaseFile(RowCount);
+	if(RowCount > 0xFFFFFFFF){
+		CString Mssg;
+		Mssg.Format("%s has too many rows to map, it can only be streamed\r\n", (LPCTSTR)File);
+		throw Mssg;
+	}
+	Rows = (COUNTER)RowCount;
+
+	for(COUNTER v=0; v<VariableCount; v++)
+		XData[v] = mapColumn(Columns[v], v);
+	YData = mapColumn(Columns[VariableCount], VariableCount);
+	LoadSeconds = (double)(CThreadPool::getTicks() - Start)/CThreadPool::getTickFrequency();
+}
+
+void CCaseTable::streamCases(){
+
+	//Only the first rows are read here; the table is small at any size of the file
+	unsigned __int64 Start = CThreadPool::getTicks();
+	openCaseFile(StreamRows);
+	Rows = (StreamRows < CASESAMPLEROWS) ? (COUNTER)StreamRows : CASESAMPLEROWS;
+
+	CFile In;
+	if(!In.Open(File, CFile::modeRead | CFile::shareDenyNone | CFile::typeBinary))
+		throw CString(_T("Could not open the fitness cases ")) + File;
+	Values.resize(Rows, VariableCount + 1);
+	readRows(In, 0, Rows, Values);
+	In.Close();
+
+	for(COUNTER v=0; v<VariableCount; v++)
+		XData[v] = Values.getColumn(v);
+	YData = Values.getColumn(VariableCount);
+	LoadSeconds = (double)(CThreadPool::getTicks() - Start)/CThreadPool::getTickFrequency();
+}
+
+void CCaseTable::readRows(CFile& In, unsigned __int64 First, COUNTER Count, CCaseColumns& Out) const{
+
+	//Count rows from row First of every column in use into the columns of Out,
+	//the inputs then the target. Float32 values are read into the first half of
+	//their column and widened in place from the last one down
+	try{
+		for(COUNTER c=0; c<Columns.size(); c++){
+			const CCaseFileColumn& Column = Columns[c];
+			unsigned __int64 Width = (Column.Type == CASECOLUMN_FLOAT32) ? sizeof(float) : sizeof(double);
+			In.Seek((LONGLONG)(Column.Offset + First*Width), CFile::begin);
+
+			char* p = (char*)Out.getColumn(c);
+			for(unsigned __int64 Bytes = Width*Count; Bytes; ){
+				UINT Part = (Bytes > CASEFILEBLOCKBYTES) ? CASEFILEBLOCKBYTES : (UINT)Bytes;
+				if(In.Read(p, Part) != Part) throw File + _T(" is a damaged binary case file\r\n");
+				p += Part;
+				Bytes -= Part;
+			}
+
+			if(Column.Type == CASECOLUMN_FLOAT32){
+				double* Widened = Out.getColumn(c);
+				const float* Narrow = (const float*)Widened;
+				for(COUNTER i=Count; i--; ){
+					double Value = Narrow[i];
+					Widened[i] = Value;
+				}
+			}
+		}
+	}
+	catch(CException* e){
+		e->Delete();
+		throw CString(_T("Could not read the fitness cases ")) + File;
+	}
+}
+
+const double* CCaseTable::mapColumn(const CCaseFileColumn& Column, COUNTER Slot){
+
+	unsigned __int64 Width = (Column.Type == CASECOLUMN_FLOAT32) ? sizeof(float) : sizeof(double);
+	unsigned __int64 Bytes = Width*Rows;
+	char Terminated[CASEFILENAME + 1];
+	memcpy(Terminated, Column.Name, CASEFILENAME);
+	Terminated[CASEFILENAME] = 0;
+	CString Name(Terminated);
+	CString Mssg;
+	if(Bytes != (SIZE_T)Bytes){
+		Mssg.Format("Column %s of %s is too large to map in this process\r\n", (LPCTSTR)Name, (LPCTSTR)File);
+		throw Mssg;
+	}
+
+	const void* View = MapViewOfFile(Mapping, FILE_MAP_READ, (DWORD)(Column.Offset >> 32), (DWORD)Column.Offset, (SIZE_T)Bytes);
+	if(!View){
+		Mssg.Format("Could not map column %s of %s, it may not fit the address space of this process\r\n", (LPCTSTR)Name, (LPCTSTR)File);
+		throw Mssg;
+	}
+	if(Column.Type == CASECOLUMN_FLOAT64){
+		Views.push_back(View);
+		return (const double*)View;
+	}
+
+	//Evaluation runs in double, so float32 columns are widened once
+	if(!Values.getColumnCount()) Values.resize(Rows, VariableCount + 1);
+	double* Widened = Values.getColumn(Slot);
+	const float* Narrow = (const float*)View;
+	for(COUNTER i=0; i<Rows; i++)
+		Widened[i] = Narrow[i];
+	UnmapViewOfFile(View);
+	return Widened;
+}
+
+
+/*******************************
+Conversion
+*******************************/
+static unsigned __int64 alignCaseFile(unsigned __int64 Offset){
+	return (Offset + CASEFILEALIGN - 1)/CASEFILEALIGN*CASEFILEALIGN;
+}
+
+static void writeAt(CFile& Out, unsigned __int64 Offset, const void* Data, unsigned __int64 Bytes){
+	Out.Seek((LONGLONG)Offset, CFile::begin);
+	for(const char* p = (const char*)Data; Bytes; ){
+		UINT Part = (Bytes > CASEFILEBLOCKBYTES) ? CASEFILEBLOCKBYTES : (UINT)Bytes;
+		Out.Write(p, Part);
+		p += Part;
+		Bytes -= Part;
+	}
+}
+
+CString CCaseTable::convert(const CString& CsvFile, const CString& CaseFile, bool Float32){
+
+	//Every column of the CSV file is written, so its column numbers stay valid;
+	//a field without a number is NaN and marks its column as not numeric
+	unsigned __int64 Start = CThreadPool::getTicks();
+	CThreadPool& Pool = *CThreadPool::getShared();
+
+	CFile In, Out;
+	if(!In.Open(CsvFile, CFile::modeRead | CFile::shareDenyWrite | CFile::typeBinary))
+		throw CString(_T("Could not open the fitness cases ")) + CsvFile;
+	if(!Out.Open(CaseFile, CFile::modeCreate | CFile::modeReadWrite | CFile::shareDenyWrite | CFile::typeBinary))
+		throw CString(_T("Could not create the binary case file ")) + CaseFile;
+
+	vector<CCsvChunkTask*> Tasks;
+	CString Report;
+	try{
+		try{
+			CCsvBlocks Blocks(In, CsvFile);
+			const char* Beg;
+			const char* End;
+			if(!Blocks.next(Beg, End)) throw CString(_T("No fitness cases in ")) + CsvFile;
+
+			//The first line sets the separator and the columns, and may be a header
+			const char* Text = Beg;
+			Beg = skipBom(Beg, End);
+			const char* Second = nextLine(Beg, End);
+			char Separator = findSeparator(Beg, Second);
+			COUNTER FieldCount = countFields(Beg, lineEnd(Beg, Second), Separator);
+			COUNTER Numbers = 0;
+			bool HasHeader = isHeader(Beg, lineEnd(Beg, Second), Separator, Numbers);
+
+			vector<CCaseFileColumn> Columns(FieldCount);
+			vector<COUNTER> Indices(FieldCount);
+			memset(&Columns[0], 0, FieldCount*sizeof(CCaseFileColumn));
+			const char* Field = Beg;
+			const char* Eol = lineEnd(Beg, Second);
+			for(COUNTER c=0; c<FieldCount; c++){
+				CCaseFileColumn& Column = Columns[c];
+				Indices[c] = c;
+				Column.Type = Float32 ? CASECOLUMN_FLOAT32 : CASECOLUMN_FLOAT64;
+				Column.Numeric = 1;
+				Column.Min = HUGE_VAL;
+				Column.Max = -HUGE_VAL;
+
+				CString Name;
+				if(HasHeader){
+					const char* FieldEnd = fieldEnd(Field, Eol, Separator);
+					Name = CString(Field, (int)(FieldEnd - Field));
+					Name.Trim(_T(" \""));
+					Field = FieldEnd + 1;
+				}
+				if(Name.IsEmpty()) Name.Format("Column %d", c);
+				lstrcpyn(Column.Name, Name, CASEFILENAME);
+			}
+			if(HasHeader) Beg = Second;
+			size_t HeadBytes = Beg - Text;
+
+			//First pass counts the rows, since every column is laid out before any is written
+			unsigned __int64 RowCount = 0;
+			unsigned __int64 CsvBytes = 0;
+			do{
+				CsvBytes += End - Text;
+				for(const char* Line = Beg; Line < End; ){
+					const char* Next = nextLine(Line, End);
+					if(lineEnd(Line, Next) > Line) RowCount++;
+					Line = Next;
+				}
+				if(Blocks.next(Beg, End)) Text = Beg;
+				else break;
+			}while(true);
+			if(!RowCount) throw CString(_T("No fitness cases in ")) + CsvFile;
+			if(RowCount > 0xFFFFFFFF) throw CString(_T("Too many rows for a binary case file in ")) + CsvFile;
+
+			unsigned __int64 Width = Float32 ? sizeof(float) : sizeof(double);
+			unsigned __int64 GroupCount = (RowCount + CASEFILEGROUPROWS - 1)/CASEFILEGROUPROWS;
+			unsigned __int64 Offset = alignCaseFile(sizeof(CCaseFileHeader) + FieldCount*sizeof(CCaseFileColumn));
+			for(COUNTER c=0; c<FieldCount; c++){
+				Columns[c].Offset = Offset;
+				Offset = alignCaseFile(Offset + RowCount*Width);
+			}
+			CCaseFileHeader Header;
+			memset(&Header, 0, sizeof(Header));
+			memcpy(Header.Magic, CaseFileMagic, sizeof(CaseFileMagic));
+			Header.Version = CASEFILEVERSION;
+			Header.ColumnCount = FieldCount;
+			Header.RowCount = RowCount;
+			Header.GroupRows = CASEFILEGROUPROWS;
+			Header.IndexOffset = Offset;
+			vector<CCaseFileRange> Index((size_t)(GroupCount*FieldCount));
+			for(COUNTER r=0; r<Index.size(); r++){
+				Index[r].Min = HUGE_VAL;
+				Index[r].Max = -HUGE_VAL;
+			}
+			Out.SetLength(Offset + Index.size()*sizeof(CCaseFileRange));
+
+			//Second pass parses each block on the pool and writes its rows into every column
+			Blocks.rewind();
+			Blocks.next(Beg, End);
+			Beg += HeadBytes;
+			unsigned __int64 Row = 0;
+			vector<float> Narrowed;
+			do{
+				parseChunks(Pool, Beg, End, Separator, Indices, FieldCount, false, Tasks);
+				for(COUNTER t=0; t<Tasks.size(); t++){
+					COUNTER Count = Tasks[t]->getRowCount();
+					if(Row + Count > RowCount) throw CString(_T("The fitness cases changed while converting ")) + CsvFile;
+
+					for(COUNTER c=0; c<FieldCount; c++){
+						vector<double>& Values = Tasks[t]->Values[c];
+						if(Float32){
+							Narrowed.assign(Values.begin(), Values.end());
+							for(COUNTER i=0; i<Count; i++)
+								Values[i] = Narrowed[i];
+						}
+
+						//Empty ranges, Min above Max, where a column holds no number
+						CCaseFileColumn& Column = Columns[c];
+						for(COUNTER i=0; i<Count; i++){
+							double Value = Values[i];
+							if(Value - Value != 0.0f){
+								Column.Numeric = 0;
+								continue;
+							}
+							CCaseFileRange& Range = Index[(size_t)(((Row + i)/CASEFILEGROUPROWS)*FieldCount + c)];
+							if(Value < Range.Min) Range.Min = Value;
+							if(Value > Range.Max) Range.Max = Value;
+						}
+						if(Count){
+							if(Float32) writeAt(Out, Column.Offset + Row*Width, &Narrowed[0], Count*Width);
+							else writeAt(Out, Column.Offset + Row*Width, &Values[0], Count*Width);
+						}
+					}
+					Row += Count;
+					delete Tasks[t];
+					Tasks[t] = NULL;
+				}
+				Tasks.clear();
+			}while(Blocks.next(Beg, End));
+			if(Row != RowCount) throw CString(_T("The fitness cases changed while converting ")) + CsvFile;
+
+			for(COUNTER r=0; r<Index.size(); r++){
+				CCaseFileColumn& Column = Columns[r % FieldCount];
+				if(Index[r].Min < Column.Min) Column.Min = Index[r].Min;
+				if(Index[r].Max > Column.Max) Column.Max = Index[r].Max;
+			}
+			writeAt(Out, Header.IndexOffset, &Index[0], Index.size()*sizeof(CCaseFileRange));
+			writeAt(Out, sizeof(Header), &Columns[0], FieldCount*sizeof(CCaseFileColumn));
+
+			//The header goes last, so a conversion cut short never leaves a valid file
+			writeAt(Out, 0, &Header, sizeof(Header));
+			Out.Close();
+			In.Close();
+
+			double Seconds = (double)(CThreadPool::getTicks() - Start)/CThreadPool::getTickFrequency();
+			Report.Format("%d rows of %d columns converted from %s to %s in %.2f s (%.1f MB/s)", (COUNTER)RowCount, FieldCount,
+				(LPCTSTR)CsvFile, (LPCTSTR)CaseFile, Seconds, (Seconds > 0.0f) ? (double)CsvBytes/(1024.0f*1024.0f)/Seconds : 0.0f);
+			if(HasHeader && Numbers) Report += headerWarning(Numbers);
+		}
+		catch(CException* e){
+			e->Delete();
+			throw CString(_T("Could not write the binary case file ")) + CaseFile;
+		}
+	}
+	catch(CString Mssg){
+		for(COUNTER t=0; t<Tasks.size(); t++)
+			delete Tasks[t];
+		Out.Abort();
+		DeleteFile(CaseFile);
+		throw Mssg;
+	}
+	return Report;
+}
+
+CString CCaseTable::getReport() const{
+	CString Report;
+	if(Mapped){
+		Report.Format("%d fitness cases mapped from %s in %.3f s", Rows, (LPCTSTR)File, LoadSeconds);
+		return Report;
+	}
+	if(Streamed){
+		Report.Format("%.0f fitness cases streamed from %s, the first %d of them read in %.3f s",
+			(double)StreamRows, (LPCTSTR)File, Rows, LoadSeconds);
+		return Report;
+	}
+	Report.Format("%d fitness cases read from %s in %.2f s (%.1f MB/s)", Rows, (LPCTSTR)File,
+		LoadSeconds, (LoadSeconds > 0.0f) ? (double)FileBytes/(1024.0f*1024.0f)/LoadSeconds : 0.0f);
+	if(HeaderNumbers) Report += headerWarning(HeaderNumbers);
+	return Report;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "CaseColumns.h"
+
+#define CSVCHUNKBYTES (4*1024*1024)
+//Text parsed by one pool task when fitness cases are read from a CSV file
+
+#define CSVMAXFIELD 512
+//Longest number the slow path of the CSV parser hands to strtod
+
+#define CASEFILEBLOCKBYTES (64*1024*1024)
+//CSV text converted to a binary case file at a time, whatever the size of the file
+
+#define CASEFILEALIGN 65536
+//Columns of a binary case file start on allocation granularity, so each maps on its own
+
+#define CASEFILEGROUPROWS 65536
+//Rows summarized by one entry of the row group index of a binary case file
+
+#define CASEFILEVERSION 1
+//Layout written to, and required of, binary case files
+
+#define CASEFILENAME 48
+//Bytes of a column name in a binary case file, terminating zero included
+
+#define CASESAMPLEROWS 4096
+//First rows of a streamed binary case file kept in memory, e.g. to draw
+
+class CThreadPool;
+
+enum CASECOLUMNTYPE{ CASECOLUMN_FLOAT64, CASECOLUMN_FLOAT32 };
+
+
+/*******************************
+Binary case file, little endian: the
+header, a descriptor per column, each
+column as one array on its own aligned
+offset, then the row group index: the
+range of every column over each run of
+GroupRows rows, group after group.
+*******************************/
+struct CCaseFileHeader
+{
+	char Magic[8];
+	DWORD Version;
+	DWORD ColumnCount;
+	unsigned __int64 RowCount;
+	unsigned __int64 GroupRows;			//0 without a row group index
+	unsigned __int64 IndexOffset;
+};
+
+struct CCaseFileColumn
+{
+	char Name[CASEFILENAME];
+	DWORD Type;							//CASECOLUMNTYPE
+	DWORD Numeric;						//every row holds a finite number
+	unsigned __int64 Offset;			//of the first value, from the start of the file
+	double Min, Max;					//over the numbers of the column
+};
+
+struct CCaseFileRange
+{
+	double Min, Max;
+};
+
+
+/*******************************
+Fitness cases read from a file: the
+input columns and the target column.
+A table is read once and shared, read
+only, by every population of the process
+that names the same file and columns.
+A CSV file is parsed into memory; the
+columns of a binary case file are mapped
+and read in place, so opening one takes
+the same time at any size. Float32
+columns are widened into memory.
+A streamed binary case file keeps only
+its first rows in memory; its rows are
+read through a CCaseStream instead.
+*******************************/
+class CCaseTable
+{
+	CString File;
+	COUNTER XColumns[MAXVARIABLES];		//of X_1 to X_VariableCount
+	COUNTER VariableCount;
+	COUNTER YColumn;
+	LONG References;					//under CacheLock
+
+	CCaseColumns Values;				//parsed or widened: the inputs, then the target
+	const double* XData[MAXVARIABLES];	//columns of Values, or mapped
+	const double* YData;
+	COUNTER Rows;
+	double XMin, XMax;
+	double LoadSeconds;
+	unsigned __int64 FileBytes;
+	COUNTER HeaderNumbers;				//fields with a number in the line read as a CSV header
+	bool Mapped;
+	bool Streamed;
+	unsigned __int64 StreamRows;		//of the file, when streamed
+	vector<CCaseFileColumn> Columns;	//read from the file: the inputs, then the target
+
+	HANDLE FileHandle;
+	HANDLE Mapping;
+	vector<const void*> Views;
+
+	static CCriticalSection CacheLock;
+	static vector<CCaseTable*> Cache;
+
+	CCaseTable(const CString& F, const COUNTER* XCols, COUNTER Variables, COUNTER YCol, bool Stream);
+	~CCaseTable();
+	bool reads(const CString& F, const COUNTER* XCols, COUNTER Variables, COUNTER YCol, bool Stream) const;
+	void loadCsv(CThreadPool& Pool);
+	void openCaseFile(unsigned __int64& RowCount);
+	void checkColumn(const CCaseFileColumn& Column, unsigned __int64 RowCount) const;
+	void mapCases();
+	void streamCases();
+	const double* mapColumn(const CCaseFileColumn& Column, COUNTER Slot);
+	static bool isCaseFile(const CString& File);
+
+public:
+	static CCaseTable* open(const CString& File, const COUNTER* XColumns, COUNTER VariableCount,
+		COUNTER YColumn, bool Streamed = false);	//throws CString
+	static void release(CCaseTable* Table);
+	static CString convert(const CString& CsvFile, const CString& CaseFile, bool Float32);	//throws CString
+
+	COUNTER getRowCount() const { return Rows; };
+	COUNTER getVariableCount() const { return VariableCount; };
+	const double* getX(COUNTER Variable) const { return XData[Variable]; };	//column of X_Variable+1
+	const double* getY() const { return YData; };
+	double getXMin() const { return XMin; };		//range of X_1
+	double getXMax() const { return XMax; };
+	bool isMapped() const { return Mapped; };
+	CString getReport() const;			//rows read and parse throughput
+
+	//Rows of a streamed table are read by the caller, on its own file
+	bool isStreamed() const { return Streamed; };
+	unsigned __int64 getStreamRows() const { return StreamRows; };
+	const CString& getFile() const { return File; };
+	void readRows(CFile& In, unsigned __int64 First, COUNTER Count, CCaseColumns& Out) const;	//throws CString
+};
@@ -1,6 +1,11 @@
 #include "StdAfx.h"
 #include "FitnessClass.h"
 #include ".\dnastatement.h"
+#include "RationalForm.h"
+
+//64 bit FNV-1a, see getHash
+static const unsigned __int64 FNVOFFSET = ((unsigned __int64)0xCBF29CE4 << 32) | 0x84222325;
+static const unsigned __int64 FNVPRIME = ((unsigned __int64)0x00000100 << 32) | 0x000001B3;
 
 /*
 #define GETCONST(SomeVal) \
@@ -239,15 +244,43 @@ void CDNAStatement::simplify(){
 				break;	
 			}
 	}
-	if(goAgain) simplify();
+	if(goAgain){
+		simplify();
+		return;
+	}
+
+	//Exact simplification from the rational normal form: a branch that
+	//reduces to x or to one of the constants is replaced by that terminal,
+	//unless a divisor cancelled in the reduction, as the terminal would be
+	//defined where the branch is not.
+	if(!arity) return;
+	try{
+		CRationalForm Form;
+		if(!Form.compile(*this) || Form.hasHoles()) return;
+
+		GENEStatementType Terminal = UNDEF;
+		if(Form.isIdentity()) Terminal = X_1;
+		else if(Form.isConstant() && (Form.getDenominator().getLeading() == 1.0f))
+			for(unsigned int T = BEGCONST; T <= ENDTERM; T++)
+				if(FromConst((GENEStatementType)T).x() == Form.getNumerator().getLeading())
+					Terminal = (GENEStatementType)T;
+
+		if(Terminal != UNDEF){
+			CDNAStatement M(Terminal, TreeDensity);
+			copy(M);
+		}
+	}
+	catch(CString Exc){
+		//UNDEF branches are left as they are
+	}
 }
 
 
 
-void CDNAStatement::grow(COUNTER MaxDepth){
+void CDNAStatement::grow(COUNTER MaxDepth, COUNTER Variables){
     try{
 		for(unsigned int i = 0; i < SubStatements.size(); i++)
-			SubStatements[i]->growCreate(MaxDepth - 1);        
+			SubStatements[i]->growCreate(MaxDepth - 1, Variables);        
     }
     catch(CString Ecx){
         CString R(_T(" at CDNAStatement::grow-->\r\n"));
@@ -256,19 +289,19 @@ void CDNAStatement::grow(COUNTER MaxDepth){
     }
 }
 
-void CDNAStatement::growCreate(COUNTER Maxdepth){
+void CDNAStatement::growCreate(COUNTER Maxdepth, COUNTER Variables){
 	//If at the end, we need a terminal.
         //If not at the end, we might get a Terminal 
         //or a function. So i flip a coin
-        if((Maxdepth + 1 <= 0)||((rand()%100 >= TreeDensity))){
-                copy(CDNAStatement(CFunctionSet::getRandTerminal()));
+        if((Maxdepth + 1 <= 0)||((CRandom::current().below(100) >= TreeDensity))){
+                copy(CDNAStatement(CFunctionSet::getRandTerminal(Variables)));
                 return;
 	}
 	this->copy(CDNAStatement (CFunctionSet::getRandFunction()));
 
 	for(COUNTER i = 0; i<this->SubStatements.size(); i++){
 		try{
-			this->SubStatements[i]->growCreate(Maxdepth-1);
+			this->SubStatements[i]->growCreate(Maxdepth-1, Variables);
 		}
 		catch(CString Err){
 			CString R(_T(" at CDNAStatement::growCreate\r\n"));
@@ -292,27 +325,38 @@ F<double> CDNAStatement::FromConst(GENEStatementType C){
 
 
 F<double> CDNAStatement::Eval(F<double> val){
+	F<double> Inputs[MAXVARIABLES];
+	Inputs[0] = val;
+	for(COUNTER v=1; v<MAXVARIABLES; v++)
+		Inputs[v] = 0.0f;
+	return Eval(Inputs);
+}
+
+F<double> CDNAStatement::Eval(const F<double>* Inputs){
 
 	
 	try{
+		if(CFunctionSet::isVariable(Type))
+			return Inputs[CFunctionSet::getVariable(Type)];
+
 		switch (Type){
 	            
 			case UNDEF:
 				throw CString(_T("UNDEF"));
 		                
 			case PLUS:
-				return  SubStatements[0]->Eval(val) + SubStatements[1]->Eval(val);
+				return  SubStatements[0]->Eval(Inputs) + SubStatements[1]->Eval(Inputs);
 		                
 			case MINUS:
-				return  SubStatements[0]->Eval(val) - SubStatements[1]->Eval(val);
+				return  SubStatements[0]->Eval(Inputs) - SubStatements[1]->Eval(Inputs);
 		                
 			case DIV:{
-					F<double> Den = SubStatements[1]->Eval(val); 
+					F<double> Den = SubStatements[1]->Eval(Inputs); 
 					if( Den == 0.0f) throw CString(_T("UNDEF"));
-					return  SubStatements[0]->Eval(val) / Den;
+					return  SubStatements[0]->Eval(Inputs) / Den;
 				}
 			case MULT:
-				return  SubStatements[0]->Eval(val) * SubStatements[1]->Eval(val);
+				return  SubStatements[0]->Eval(Inputs) * SubStatements[1]->Eval(Inputs);
 		                
 			
 			case N_1:
@@ -320,9 +364,6 @@ F<double> CDNAStatement::Eval(F<double> val){
 			case N_3:
 			case N_5:
 				return FromConst(Type);
-		            
-			case X_1:
-				return val;
 		}
 		CString Xcept;
 		Xcept.Format("Unknown statement [%d] at CDNAStatement::Eval", (COUNTER)Type);
@@ -333,7 +374,8 @@ F<double> CDNAStatement::Eval(F<double> val){
 			throw Exc;
 		else{
 			CString Mess;
-			Mess.Format("Impossible to evaluate function at value [%f] CDNAStatement::Eval -->\r\n", val);
+			F<double> X1 = Inputs[0];
+			Mess.Format("Impossible to evaluate function at X_1 [%f] CDNAStatement::Eval -->\r\n", X1.x());
 			Mess = Exc + Mess;    
 			throw Mess;
 		}
@@ -344,13 +386,13 @@ F<double> CDNAStatement::Eval(F<double> val){
 Breeding Methods
 ******************************/
 
-CDNAStatement& CDNAStatement::operator*(CDNAStatement& Dad) {
+CDNAStatement& CDNAStatement::cross(CDNAStatement& Dad, COUNTER Variables) {
 
         CDNAStatement* Kid = new CDNAStatement(*this);
         
         unsigned int DadDepth = Dad.getDepth();
         unsigned int MomDepth = getDepth();
-        int CrossDepthKid = (rand()%this->CrossOverMaxDepth)%
+        int CrossDepthKid = CRandom::current().below(this->CrossOverMaxDepth)%
                             ((MomDepth < DadDepth)? MomDepth:DadDepth);
         CrossDepthKid++;
         if(CrossDepthKid < 2) CrossDepthKid = 2;
@@ -374,19 +416,19 @@ CDNAStatement& CDNAStatement::operator*(CDNAStatement& Dad) {
             }
         }
         
-	Kid->mutate();
+	Kid->mutate(Variables);
 	Kid->Fitness->reset();
         return *Kid;
 
  }
-void CDNAStatement::mutate(){
+void CDNAStatement::mutate(COUNTER Variables){
     
 	int MutProb = (int)(MutationPbblty *1000.0f);
 	
-	while(rand()%1000 < MutProb){
-		int MutDepthKid = (rand()%getDepth())+1;
+	while((int)CRandom::current().below(1000) < MutProb){
+		int MutDepthKid = CRandom::current().below(getDepth())+1;
 		CDNAStatement* MutPart = NULL;
-		switch(rand()%2){
+		switch(CRandom::current().below(2)){
 	
 			case 0:
 				MutPart = this->getBranchRandomType(MutDepthKid, TERMINAL);
@@ -403,22 +445,22 @@ void CDNAStatement::mutate(){
 				switch(CFunctionSet::GetTypeClass(MutPart->Type)){
         
 					case(TERMINAL):
-						T = CDNAStatement(CFunctionSet::getRandTerminal());
+						T = CDNAStatement(CFunctionSet::getRandTerminal(Variables));
 						break;
 
 
 					case (FUNC):
 						T = CDNAStatement(CFunctionSet::getRandFunction());
-						switch(rand()%2){
+						switch(CRandom::current().below(2)){
 							case 0:
-								T.grow(MutPart->getDepth());		
+								T.grow(MutPart->getDepth(), Variables);		
 								break;
 							case 1:{
-								int index = rand()%T.SubStatements.size();
+								int index = CRandom::current().below((COUNTER)T.SubStatements.size());
 								T.SubStatements[index]->copy(*MutPart);
 								for(COUNTER i=0; i<T.SubStatements.size();i++)
 									if(i != index)
-										T.SubStatements[i]->growCreate(MutPart->getDepth());	
+										T.SubStatements[i]->growCreate(MutPart->getDepth(), Variables);	
 								break;
 							       }
 						}		
@@ -447,7 +489,7 @@ void CDNAStatement::mutate(){
         }
 
         if(candidates.size())
-            return candidates[rand()%candidates.size()];
+            return candidates[CRandom::current().below((COUNTER)candidates.size())];
         else 
             return ((CDNAStatement*)0);
 }
@@ -468,7 +510,7 @@ void CDNAStatement::draw(COUNTER FitCaseNum, double RangeMin, double RangeMax){
 			for(COUNTER i=1; i<FitCaseNum-1; i++){
 			
 				x2 = RangeMin + (i*IntervalSize);	//Pick a point 
-				int somewhere = rand()%100;		//in the interval,
+				int somewhere = CRandom::current().below(100);		//in the interval,
 				if (somewhere) x2+= (1.0f/double(somewhere))*IntervalSize;	//somewhere in the interval.
 				y2 = Eval((F<double>)x2).x();
 
@@ -494,12 +536,83 @@ void CDNAStatement::draw(COUNTER FitCaseNum, double RangeMin, double RangeMax){
 		}
 }
 
+void CDNAStatement::drawCases(const double* Inputs, COUNTER Variables, COUNTER Count){
+	//With several inputs there is no curve in X_1 alone, so the individual
+	//is drawn at the rows of inputs given, in their order
+	F<double> Row[MAXVARIABLES];
+	for(COUNTER v=0; v<MAXVARIABLES; v++)
+		Row[v] = 0.0f;
+
+	double x1 = 0.0f;
+	double y1 = 0.0f;
+	bool Joined = false;				//to the last row drawn
+	for(COUNTER i=0; i<Count; i++){
+		for(COUNTER v=0; v<Variables; v++)
+			Row[v] = Inputs[i*Variables + v];
+		double x2 = Inputs[i*Variables];
+		double y2;
+		try{
+			y2 = Eval(Row).x();
+		}
+		catch(CString Err){
+			if(Err != CString(_T("UNDEF"))) throw Err;
+			Joined = false;
+			continue;
+		}
 
+		if(Joined){
+			glBegin(GL_LINES);
+				glVertex3f((GLfloat) x1, (GLfloat) y1, 0.0f);
+				glVertex3f((GLfloat) x2, (GLfloat) y2, 0.0f);
+			glEnd();
+		}
+		x1 = x2;
+		y1 = y2;
+		Joined = true;
+	}
+}
 
 
+/*************************
+Binary encoding
+**************************/
+void CDNAStatement::encode(vector<unsigned char>& Buffer) const{
+	Buffer.push_back((unsigned char)Type);
+	for(COUNTER i=0; i<SubStatements.size(); i++)
+		SubStatements[i]->encode(Buffer);
+}
 
+unsigned __int64 CDNAStatement::getHash() const{
+	//Over the prefix form encode writes: arities are fixed by the node types,
+	//so equal hashes mean equal trees up to 64 bit collisions
+	unsigned __int64 Hash = FNVOFFSET;
+	hash(Hash);
+	return Hash;
+}
 
+void CDNAStatement::hash(unsigned __int64& Hash) const{
+	Hash = (Hash ^ (unsigned char)Type) * FNVPRIME;
+	for(COUNTER i=0; i<SubStatements.size(); i++)
+		SubStatements[i]->hash(Hash);
+}
 
+CDNAStatement* CDNAStatement::decode(const unsigned char*& Pos, const unsigned char* End, int treeDensity){
+	if(Pos >= End) throw CString(_T("Truncated individual at CDNAStatement::decode\r\n"));
 
+	GENEStatementType T = (GENEStatementType)*(Pos++);
+	if((unsigned int)T > ENDFUNC) throw CString(_T("Unknown node type at CDNAStatement::decode\r\n"));
 
-
+	CDNAStatement* S = new CDNAStatement(T, treeDensity);
+	try{
+		for(COUNTER i=0; i<S->arity; i++){
+			CDNAStatement* Branch = decode(Pos, End, treeDensity);
+			delete S->SubStatements[i];
+			S->SubStatements[i] = Branch;
+		}
+	}
+	catch(CString Err){
+		delete S;
+		throw Err;
+	}
+	return S;
+}
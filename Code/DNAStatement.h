@@ -31,12 +31,13 @@ protected:
     
 	void addBranch(unsigned int i, const CDNAStatement& S);
         bool removeBranch(unsigned int i);
+	void hash(unsigned __int64& Hash) const;
         
             
         static int MemTrace(int t){
-                static int Mem = 0;
-                Mem += t;
-                return Mem;
+                //Offspring are built on pool workers
+                static volatile LONG Mem = 0;
+                return (int)InterlockedExchangeAdd(&Mem, t) + t;
             }    
 	int TreeDensity;
             
@@ -62,6 +63,7 @@ public:
         unsigned int getDepth() const;   //Length of longer branch
         unsigned int getArity() const { return arity;};
         GENEStatementType getRoot() const {return Type;};
+        const CDNAStatement& getBranch(unsigned int i) const {return *(SubStatements[i]);};
 
         bool operator == (const CDNAStatement& S) const;
         const CDNAStatement& operator[] (unsigned int i);
@@ -69,20 +71,28 @@ public:
             return (S.Type == UNDEF);
         };
 
-	F<double> FromConst(GENEStatementType C);
+	static F<double> FromConst(GENEStatementType C);
 	void toTreeCtrl(CTreeCtrl* Tctrl, HTREEITEM branch);
 
-        void grow(unsigned int MaxDepth);
-        void growCreate(unsigned int Maxdepth);
+        //Terminals are drawn from the constants and X_1 to X_Variables
+        void grow(unsigned int MaxDepth, COUNTER Variables);
+        void growCreate(unsigned int Maxdepth, COUNTER Variables);
         CString toString();
         
 	
-	CDNAStatement& operator*(CDNAStatement& C) ;
-	void mutate();
+	CDNAStatement& cross(CDNAStatement& C, COUNTER Variables);
+	void mutate(COUNTER Variables);
 	CDNAStatement* getBranchRandomType(COUNTER MaxDepth, FUNCTIONTYPECLASS BranchType);
 
 	void simplify();
-        F<double> Eval(F<double> val);
+        F<double> Eval(const F<double>* Inputs);		//Inputs[0] is X_1
+        F<double> Eval(F<double> val);				//at X_1 = val, any other input 0
 	void draw(COUNTER PointsNum, double Min, double Max);
+	void drawCases(const double* Inputs, COUNTER Variables, COUNTER Count);	//at rows of inputs, against X_1
+
+	//Compact binary form for migration: node types in prefix order, a byte each
+	void encode(vector<unsigned char>& Buffer) const;
+	static CDNAStatement* decode(const unsigned char*& Pos, const unsigned char* End, int treeDensity = 50);
+	unsigned __int64 getHash() const;		//structural, of that same prefix form
 
 };
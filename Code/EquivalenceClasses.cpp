@@ -0,0 +1,222 @@
+#include "StdAfx.h"
+#include "FitnessClass.h"
+#include "DNAStatement.h"
+#include "EvaluatingFunction.h"
+#include ".\equivalenceclasses.h"
+
+
+/*******************************
+Exact Form Methods
+*******************************/
+void CExactForm::trim(vector<CBigInt>& P){
+	while(P.size() && P.back().isZero())
+		P.pop_back();
+}
+
+vector<CBigInt> CExactForm::add(const vector<CBigInt>& A, const vector<CBigInt>& B, bool Subtract){
+	vector<CBigInt> Res(A);
+	if(Res.size() < B.size()) Res.resize(B.size());
+	for(COUNTER k=0; k<B.size(); k++)
+		Res[k] = Subtract ? Res[k] - B[k] : Res[k] + B[k];
+	trim(Res);
+	return Res;
+}
+
+vector<CBigInt> CExactForm::mult(const vector<CBigInt>& A, const vector<CBigInt>& B){
+	vector<CBigInt> Res;
+	if(A.empty() || B.empty()) return Res;
+
+	Res.resize(A.size() + B.size() - 1);
+	for(COUNTER i=0; i<A.size(); i++)
+		for(COUNTER j=0; j<B.size(); j++)
+			Res[i+j] = Res[i+j] + A[i]*B[j];
+	trim(Res);
+	return Res;
+}
+
+void CExactForm::compile(const CDNAStatement& S){
+	//Throws "UNDEF" for undefined leaves and identically zero denominators
+	GENEStatementType T = S.getRoot();
+	Num.clear();
+	Den.clear();
+	Den.push_back(CBigInt(1));
+	Poles = Den;
+
+	if(T == UNDEF) throw CString(_T("UNDEF"));
+	if(CFunctionSet::isVariable(T) && (T != X_1))
+		throw CString(_T("No exact form of an input other than X_1 at CExactForm::compile"));
+
+	if(T == X_1){
+		Num.push_back(CBigInt(0));
+		Num.push_back(CBigInt(1));
+		return;
+	}
+
+	if(CFunctionSet::isTerminal(T)){
+		Num.push_back(CBigInt(CDNAStatement::FromConst(T).x()));
+		trim(Num);
+		return;
+	}
+
+	CExactForm A, B;
+	A.compile(S.getBranch(0));
+	B.compile(S.getBranch(1));
+	Poles = mult(A.Poles, B.Poles);
+
+	switch(T){
+		case PLUS:
+		case MINUS:
+			Num = add(mult(A.Num, B.Den), mult(B.Num, A.Den), T == MINUS);
+			Den = mult(A.Den, B.Den);
+			break;
+
+		case MULT:
+			Num = mult(A.Num, B.Num);
+			Den = mult(A.Den, B.Den);
+			break;
+
+		case DIV:
+			if(B.Num.empty()) throw CString(_T("UNDEF"));
+			Num = mult(A.Num, B.Den);
+			Den = mult(A.Den, B.Num);
+			Poles = mult(Poles, B.Num);
+			break;
+
+		default:{
+			CString Xcept;
+			Xcept.Format("Unknown statement [%d] at CExactForm::compile", (COUNTER)T);
+			throw Xcept;
+		}
+	}
+}
+
+bool CExactForm::operator==(const CExactForm& F) const{
+	//P1/Q1 == P2/Q2  <=>  P1*Q2 - P2*Q1 == 0, and the poles only differ by
+	//a constant factor, so both are undefined at the same cases
+	if(!(mult(Num, F.Den) == mult(F.Num, Den))) return false;
+	return mult(Poles, vector<CBigInt>(1, F.Poles.back())) == mult(F.Poles, vector<CBigInt>(1, Poles.back()));
+}
+
+
+/*******************************
+Equivalence Classes Admin
+*******************************/
+CEquivalenceClasses::CEquivalenceClasses():
+GroupCount(0){
+}
+
+
+/*******************************
+Grouping Methods
+*******************************/
+static unsigned __int64 PowMod(unsigned __int64 b, unsigned __int64 e){
+	unsigned __int64 Res = 1;
+	b %= FINGERPRINTPRIME;
+	while(e){
+		if(e & 1) Res = (Res*b) % FINGERPRINTPRIME;
+		b = (b*b) % FINGERPRINTPRIME;
+		e >>= 1;
+	}
+	return Res;
+}
+
+bool CEquivalenceClasses::fingerprint(const CDNAStatement& S, unsigned __int64 x, unsigned __int64& Val){
+	//Value of the individual at x in exact modular arithmetic. Identical
+	//functions always share it; false when a division by zero is met.
+	GENEStatementType T = S.getRoot();
+
+	if(T == UNDEF) return false;
+	if(CFunctionSet::isVariable(T)){
+		//Every input at its own point; trees reading inputs other than X_1
+		//are only confirmed equal when they are identical, see areEquivalent
+		unsigned __int64 k = CFunctionSet::getVariable(T);
+		Val = (x*(2*k + 1) + k*7919) % FINGERPRINTPRIME;
+		return true;
+	}
+	if(CFunctionSet::isTerminal(T)){
+		Val = (unsigned __int64)CDNAStatement::FromConst(T).x();
+		return true;
+	}
+
+	unsigned __int64 A, B;
+	if(!fingerprint(S.getBranch(0), x, A)) return false;
+	if(!fingerprint(S.getBranch(1), x, B)) return false;
+
+	switch(T){
+		case PLUS:	Val = (A + B) % FINGERPRINTPRIME;						return true;
+		case MINUS:	Val = (A + FINGERPRINTPRIME - B) % FINGERPRINTPRIME;	return true;
+		case MULT:	Val = (A * B) % FINGERPRINTPRIME;						return true;
+		case DIV:
+			if(!B) return false;
+			Val = (A * PowMod(B, FINGERPRINTPRIME - 2)) % FINGERPRINTPRIME;
+			return true;
+	}
+	return false;
+}
+
+bool CEquivalenceClasses::areEquivalent(const vector<CDNAStatement*>& Population, COUNTER i, COUNTER j) const{
+
+	//Reduced normal forms and their holes are canonical
+	if(Forms[i].isValid() && Forms[j].isValid())
+		return Forms[i] == Forms[j];
+
+	if(*Population[i] == *Population[j]) return true;
+
+	if((Population[i]->getSize() > MAXEXACTSIZE) || (Population[j]->getSize() > MAXEXACTSIZE))
+		return false;
+
+	try{
+		CExactForm A, B;
+		A.compile(*Population[i]);
+		B.compile(*Population[j]);
+		return A == B;
+	}
+	catch(CString Exc){
+		return false;
+	}
+}
+
+bool CEquivalenceClasses::build(const vector<CDNAStatement*>& Population, CEvaluatingFunction* Cancel){
+
+	COUNTER Size = (COUNTER)Population.size();
+	Representative.assign(Size, 0);
+	Forms.assign(Size, CRationalForm());
+	GroupCount = 0;
+
+	//Candidates are bucketed by their fingerprint at two points, then
+	//confirmed exactly against each representative of the bucket.
+	map< pair<unsigned __int64, unsigned __int64>, vector<COUNTER> > Buckets;
+
+	for(COUNTER i=0; i<Size; i++){
+		//Compiling forms takes a while on a large population, so a run
+		//being stopped does not wait for the whole of it
+		if(Cancel && !(i % GROUPCANCELCHECK) && Cancel->isCancelled()) return false;
+
+		Representative[i] = i;
+		if(!Population[i]) continue;
+
+		try{
+			Forms[i].compile(*Population[i]);
+		}
+		catch(CString Exc){
+			//Left invalid: evaluation finds the same UNDEF
+		}
+
+		pair<unsigned __int64, unsigned __int64> Key(FINGERPRINTPRIME, FINGERPRINTPRIME);
+		if(!fingerprint(*Population[i], 1234567, Key.first)) Key.first = FINGERPRINTPRIME;
+		if(!fingerprint(*Population[i], 76543211, Key.second)) Key.second = FINGERPRINTPRIME;
+
+		vector<COUNTER>& Reps = Buckets[Key];
+		for(COUNTER r=0; r<Reps.size(); r++)
+			if(areEquivalent(Population, Reps[r], i)){
+				Representative[i] = Reps[r];
+				break;
+			}
+
+		if(Representative[i] == i){
+			Reps.push_back(i);
+			GroupCount++;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "RationalForm.h"
+#include "BigInt.h"
+
+#define FINGERPRINTPRIME (unsigned __int64) 2147483647
+//2^31 - 1: products of two residues fit in 64 bits
+
+#define MAXEXACTSIZE 200
+//Trees above this size are only grouped with syntactically identical trees
+
+#define GROUPCANCELCHECK 256
+//Individuals grouped between two checks for a cancelled run
+
+class CDNAStatement;
+class CEvaluatingFunction;
+
+/*******************************
+Unreduced P(x)/Q(x) with big integer
+coefficients. Used when the double
+normal form is out of range. Poles is
+the product of every divisor of the
+tree, zero where the tree is undefined.
+*******************************/
+class CExactForm
+{
+	vector<CBigInt> Num;
+	vector<CBigInt> Den;
+	vector<CBigInt> Poles;
+
+	static void trim(vector<CBigInt>& P);
+	static vector<CBigInt> add(const vector<CBigInt>& A, const vector<CBigInt>& B, bool Subtract);
+	static vector<CBigInt> mult(const vector<CBigInt>& A, const vector<CBigInt>& B);
+
+public:
+	void compile(const CDNAStatement& S);
+	bool operator==(const CExactForm& F) const;
+};
+
+
+/*******************************
+Partition of a population into groups
+of mathematically identical individuals,
+undefined at the same cases. Only one
+representative per group needs to be
+evaluated, with the normal form compiled
+here.
+*******************************/
+class CEquivalenceClasses
+{
+	vector<COUNTER> Representative;
+	vector<CRationalForm> Forms;
+	COUNTER GroupCount;
+
+	static bool fingerprint(const CDNAStatement& S, unsigned __int64 x, unsigned __int64& Val);
+	bool areEquivalent(const vector<CDNAStatement*>& Population, COUNTER i, COUNTER j) const;
+
+public:
+	CEquivalenceClasses();
+
+	bool build(const vector<CDNAStatement*>& Population, CEvaluatingFunction* Cancel = NULL);	//false if cancelled midway
+
+	COUNTER getRepresentative(COUNTER i) const { return Representative[i]; };
+	bool isRepresentative(COUNTER i) const { return Representative[i] == i; };
+	const CRationalForm& getForm(COUNTER i) const { return Forms[i]; };
+	COUNTER getGroupCount() const { return GroupCount; };
+};
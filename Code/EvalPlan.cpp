@@ -0,0 +1,258 @@
+#include "StdAfx.h"
+#include "FitnessClass.h"
+#include "DNAStatement.h"
+#include ".\evalplan.h"
+
+
+/*******************************
+Admin Methods
+*******************************/
+CEvalPlan::CEvalPlan():
+Root(-1), TreeSize(0), CaseCost(0), FusedCount(0){
+}
+
+
+/*******************************
+Construction Methods
+*******************************/
+int CEvalPlan::addNode(PLANOPCODE Op, int Left, int Right, double Value, int Column){
+
+	CPlanKey Key;
+	Key.Op = (int)Op;
+	Key.Left = Left;
+	Key.Right = Right;
+	Key.Value = Value;
+	Key.Column = Column;
+
+	map<CPlanKey, int>::iterator Found = Index.find(Key);
+	if(Found != Index.end()) return Found->second;
+
+	CPlanNode N;
+	N.Op = Op;
+	N.Left = Left;
+	N.Right = Right;
+	N.Third = -1;
+	N.Value = Value;
+	N.Column = Column;
+	N.Slot = -1;
+	N.CanFail = false;
+	if(Left >= 0) N.CanFail = N.CanFail || Nodes[Left].CanFail;
+	if(Right >= 0){
+		N.CanFail = N.CanFail || Nodes[Right].CanFail;
+		if((Op == PLAN_DIV) && (Nodes[Right].Op != PLAN_CONST)) N.CanFail = true;
+	}
+	Nodes.push_back(N);
+
+	int Id = (int)Nodes.size() - 1;
+	Index[Key] = Id;
+	return Id;
+}
+
+int CEvalPlan::addConst(double Value){
+	return addNode(PLAN_CONST, -1, -1, Value);
+}
+
+int CEvalPlan::build(const CDNAStatement& S){
+
+	GENEStatementType T = S.getRoot();
+
+	if(T == UNDEF) throw CString(_T("UNDEF"));
+	if(CFunctionSet::isVariable(T)) return addNode(PLAN_X, -1, -1, 0.0f, (int)CFunctionSet::getVariable(T));
+	if(CFunctionSet::isTerminal(T)) return addConst(CDNAStatement::FromConst(T).x());
+
+	int L = build(S.getBranch(0));
+	int R = build(S.getBranch(1));
+
+	PLANOPCODE Op;
+	switch(T){
+		case PLUS:	Op = PLAN_PLUS;		break;
+		case MINUS:	Op = PLAN_MINUS;	break;
+		case MULT:	Op = PLAN_MULT;		break;
+		case DIV:	Op = PLAN_DIV;		break;
+		default:{
+			CString Xcept;
+			Xcept.Format("Unknown statement [%d] at CEvalPlan::build", (COUNTER)T);
+			throw Xcept;
+		}
+	}
+
+	//Invariant hoisting: a subtree without an input is a constant of the individual
+	if((Nodes[L].Op == PLAN_CONST) && (Nodes[R].Op == PLAN_CONST)){
+		double a = Nodes[L].Value;
+		double b = Nodes[R].Value;
+		switch(Op){
+			case PLAN_PLUS:		return addConst(a + b);
+			case PLAN_MINUS:	return addConst(a - b);
+			case PLAN_MULT:		return addConst(a * b);
+			case PLAN_DIV:
+				if(b == 0.0f) throw CString(_T("UNDEF"));
+				return addConst(a / b);
+		}
+	}
+
+	//Shapes known from the operands alone
+	if(L == R){
+		if((Op == PLAN_MINUS) && !Nodes[L].CanFail){
+			FusedCount++;
+			return addConst(0.0f);
+		}
+		if(Op == PLAN_MULT){
+			FusedCount++;
+			return addNode(PLAN_SQUARE, L, L, 0.0f);
+		}
+	}
+	return addNode(Op, L, R, 0.0f);
+}
+
+void CEvalPlan::markLive(vector<bool>& Live) const{
+	Live.assign(Nodes.size(), false);
+	Live[Root] = true;
+	for(COUNTER n = (COUNTER)Nodes.size(); n > 0; n--){
+		const CPlanNode& N = Nodes[n-1];
+		if(!Live[n-1]) continue;
+		if(N.Left >= 0) Live[N.Left] = true;
+		if(N.Right >= 0) Live[N.Right] = true;
+		if(N.Third >= 0) Live[N.Third] = true;
+	}
+}
+
+void CEvalPlan::fuse(){
+	//A product used only by one PLUS or MINUS is folded into it. Products
+	//shared with other parents stay as they are so nothing is computed twice.
+	vector<bool> Live;
+	markLive(Live);
+
+	vector<COUNTER> Uses(Nodes.size(), 0);
+	for(COUNTER n=0; n<Nodes.size(); n++)
+		if(Live[n]){
+			if(Nodes[n].Left >= 0) Uses[Nodes[n].Left]++;
+			if(Nodes[n].Right >= 0) Uses[Nodes[n].Right]++;
+		}
+
+	for(COUNTER n=0; n<Nodes.size(); n++){
+		CPlanNode& N = Nodes[n];
+		if(!Live[n] || ((N.Op != PLAN_PLUS) && (N.Op != PLAN_MINUS))) continue;
+
+		int Prod = -1;
+		int Addend = -1;
+		PLANOPCODE Fused = PLAN_FMA;
+		if((Nodes[N.Left].Op == PLAN_MULT) && (Uses[N.Left] == 1)){
+			Prod = N.Left;
+			Addend = N.Right;
+			Fused = (N.Op == PLAN_PLUS) ? PLAN_FMA : PLAN_FMS;
+		}
+		else if((Nodes[N.Right].Op == PLAN_MULT) && (Uses[N.Right] == 1)){
+			Prod = N.Right;
+			Addend = N.Left;
+			Fused = (N.Op == PLAN_PLUS) ? PLAN_FMA : PLAN_FNMA;
+		}
+		if(Prod < 0) continue;
+
+		N.Op = Fused;
+		N.Left = Nodes[Prod].Left;
+		N.Right = Nodes[Prod].Right;
+		N.Third = Addend;
+		FusedCount++;
+	}
+}
+
+void CEvalPlan::compile(const CDNAStatement& S){
+	//Throws "UNDEF" whenever CDNAStatement::Eval would on every case
+	Nodes.clear();
+	Index.clear();
+	TreeSize = S.getSize();
+	CaseCost = 0;
+	FusedCount = 0;
+
+	Root = build(S);
+	fuse();
+
+	vector<bool> Live;
+	markLive(Live);
+
+	int Slots = 0;
+	for(COUNTER i=0; i<Nodes.size(); i++)
+		if(Live[i] && (Nodes[i].Op >= PLAN_PLUS)){
+			Nodes[i].Slot = Slots++;
+			CaseCost++;
+		}
+		else
+			Nodes[i].Slot = -1;
+	Scratch.resize(Slots*PLANBLOCK);
+}
+
+
+/*******************************
+Evaluation Methods
+*******************************/
+const double* CEvalPlan::operand(int Id, const double* const* X, COUNTER& Step){
+	//A constant operand is read with a stride of 0 so that it is never
+	//broadcast into the scratch block.
+	const CPlanNode& N = Nodes[Id];
+	Step = (N.Op == PLAN_CONST) ? 0 : 1;
+	if(N.Op == PLAN_CONST) return &N.Value;
+	if(N.Op == PLAN_X) return X[N.Column];
+	return &Scratch[N.Slot*PLANBLOCK];
+}
+
+void CEvalPlan::run(const double* const* X, COUNTER Count, double* Out){
+	//Count must not exceed PLANBLOCK.
+	ASSERT(Count <= PLANBLOCK);
+
+	const CPlanNode& R = Nodes[Root];
+	if(R.Op == PLAN_CONST){
+		for(COUNTER i=0; i<Count; i++) Out[i] = R.Value;
+		return;
+	}
+	if(R.Op == PLAN_X){
+		for(COUNTER i=0; i<Count; i++) Out[i] = X[R.Column][i];
+		return;
+	}
+
+	for(COUNTER n=0; n<Nodes.size(); n++){
+		const CPlanNode& N = Nodes[n];
+		if(N.Slot < 0) continue;
+
+		COUNTER sa, sb, sc = 0;
+		const double* A = operand(N.Left, X, sa);
+		const double* B = operand(N.Right, X, sb);
+		const double* C = (N.Third >= 0) ? operand(N.Third, X, sc) : NULL;
+		double* D = (n == (COUNTER)Root) ? Out : &Scratch[N.Slot*PLANBLOCK];
+
+		switch(N.Op){
+			case PLAN_PLUS:
+				for(COUNTER i=0; i<Count; i++) D[i] = A[i*sa] + B[i*sb];
+				break;
+
+			case PLAN_MINUS:
+				for(COUNTER i=0; i<Count; i++) D[i] = A[i*sa] - B[i*sb];
+				break;
+
+			case PLAN_MULT:
+				for(COUNTER i=0; i<Count; i++) D[i] = A[i*sa] * B[i*sb];
+				break;
+
+			case PLAN_DIV:
+				for(COUNTER i=0; i<Count; i++)
+					if(B[i*sb] == 0.0f) throw CString(_T("UNDEF"));
+				for(COUNTER i=0; i<Count; i++) D[i] = A[i*sa] / B[i*sb];
+				break;
+
+			case PLAN_SQUARE:
+				for(COUNTER i=0; i<Count; i++) D[i] = A[i*sa] * A[i*sa];
+				break;
+
+			case PLAN_FMA:
+				for(COUNTER i=0; i<Count; i++) D[i] = A[i*sa] * B[i*sb] + C[i*sc];
+				break;
+
+			case PLAN_FMS:
+				for(COUNTER i=0; i<Count; i++) D[i] = A[i*sa] * B[i*sb] - C[i*sc];
+				break;
+
+			case PLAN_FNMA:
+				for(COUNTER i=0; i<Count; i++) D[i] = C[i*sc] - A[i*sa] * B[i*sb];
+				break;
+		}
+	}
+}
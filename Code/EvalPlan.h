@@ -0,0 +1,102 @@
+#pragma once
+
+#define PLANBLOCK 256
+//Number of fitness cases pushed through the plan at a time
+
+class CDNAStatement;
+
+enum PLANOPCODE{
+	PLAN_CONST = 0,	//hoisted constant, computed once per individual
+	PLAN_X,			//an input column, X_1 to X_16
+	PLAN_PLUS,
+	PLAN_MINUS,
+	PLAN_MULT,
+	PLAN_DIV,
+
+	//Fused kernels
+	PLAN_SQUARE,	//a*a
+	PLAN_FMA,		//a*b + c
+	PLAN_FMS,		//a*b - c
+	PLAN_FNMA,		//c - a*b
+};
+
+struct CPlanNode{
+	PLANOPCODE Op;
+	int Left;
+	int Right;
+	int Third;		//addend of the fused multiply-add kernels
+	double Value;	//PLAN_CONST only
+	int Column;		//PLAN_X only, 0 for X_1
+	int Slot;		//row of the scratch block holding this node, -1 if none
+	bool CanFail;	//a division by a non constant lies below
+};
+
+struct CPlanKey{
+	int Op;
+	int Left;
+	int Right;
+	double Value;
+	int Column;
+
+	bool operator<(const CPlanKey& K) const{
+		if(Op != K.Op) return Op < K.Op;
+		if(Left != K.Left) return Left < K.Left;
+		if(Right != K.Right) return Right < K.Right;
+		if(Column != K.Column) return Column < K.Column;
+		return Value < K.Value;
+	};
+};
+
+
+/*******************************
+Evaluation plan of an individual:
+the tree turned into a DAG where every
+distinct subexpression appears once and
+subtrees without an input are folded
+into constants ahead of time. The plan
+runs over a block of fitness cases at
+once, each input read from its column.
+
+Common shapes run as fused kernels:
+(MULT a a) as a square, (PLUS (MULT a b) c)
+and its MINUS variants as one multiply-add
+pass, and (MINUS a a) as a known zero when
+a cannot divide by zero.
+Tolerance against CDNAStatement::Eval: the
+kernels keep the rounding order of the tree,
+so results are bit identical when doubles
+are rounded on every operation (SSE2). With
+x87 code the product of a fused node may
+stay in an 80 bit register, which moves the
+result by at most one ulp of |a*b| per fused
+node. A known zero also differs where a
+overflows to infinity (Eval gives NaN).
+*******************************/
+class CEvalPlan
+{
+	vector<CPlanNode> Nodes;	//children always precede their parents
+	map<CPlanKey, int> Index;
+	vector<double> Scratch;
+	int Root;
+	COUNTER TreeSize;
+	COUNTER CaseCost;
+	COUNTER FusedCount;
+
+	int addNode(PLANOPCODE Op, int Left, int Right, double Value, int Column = -1);
+	int addConst(double Value);
+	int build(const CDNAStatement& S);
+	void fuse();
+	void markLive(vector<bool>& Live) const;
+	const double* operand(int Id, const double* const* X, COUNTER& Step);
+
+public:
+	CEvalPlan();
+
+	void compile(const CDNAStatement& S);
+	void run(const double* const* X, COUNTER Count, double* Out);	//X[v] is the column of X_v+1
+
+	COUNTER getTreeSize() const { return TreeSize; };			//node evaluations per case of the tree walk
+	COUNTER getCaseCost() const { return CaseCost; };			//node evaluations per case of the plan
+	COUNTER getDistinctCount() const { return (COUNTER)Nodes.size(); };
+	COUNTER getFusedCount() const { return FusedCount; };
+};
@@ -1,13 +1,19 @@
 #include "StdAfx.h"
 #include "FitnessClass.h"
 #include "DNAstatement.h"
+#include "CaseTable.h"
 #include ".\evaluatingfunction.h"
 
 
 CEvaluatingFunction::CEvaluatingFunction(double Rmin, double Rmax):
-RangeMin(Rmin), RangeMax(Rmax){
+Table(NULL), VariableCount(1), CasesY(NULL), CaseCount(0), RangeMin(Rmin), RangeMax(Rmax),
+NodeEvaluations(0), NodeEvaluationsSaved(0),
+Running(NULL), Stop(NULL), HasDeadline(false), Deadline(0), NodeLimit(0.0f), CaseLimit(0.0f),
+TotalNodeEvaluations(0.0f), TotalCaseEvaluations(0.0f), BudgetSpent(BUDGET_NONE), CaseVersion(0){
 
 	if(RangeMin >= RangeMax) throw CString(_T("Invalid range at CEvaluatingFunction construction\r\n"));
+	for(COUNTER v=0; v<MAXVARIABLES; v++)
+		CasesX[v] = NULL;
 }
 
 CEvaluatingFunction::~CEvaluatingFunction(void){
@@ -20,8 +26,67 @@ CEvaluatingFunction::~CEvaluatingFunction(void){
 Admin Functions
 *******************************/
 void CEvaluatingFunction::destroyPoints(){
-	FunctionY.clear();
-	FunctionX1.clear();
+	Function.clear();
+	for(COUNTER v=0; v<MAXVARIABLES; v++)
+		CasesX[v] = NULL;
+	CasesY = NULL;
+	CaseCount = 0;
+
+	//Cases only change between batches, while no worker reads a replica
+	for(COUNTER n=0; n<MAXNUMANODES; n++){
+		Replicas[n].Ready = 0;
+		Replicas[n].Columns.clear();
+	}
+}
+
+const CCaseReplica& CEvaluatingFunction::getReplica(COUNTER Node){
+	//The copy is first touched by a worker pinned to the node, so fresh
+	//pages of it are placed in that node's memory
+	CCaseReplica& R = Replicas[Node];
+	if(!R.Ready){
+		ReplicaLock.Lock();
+		if(!R.Ready){
+			R.Columns.resize(CaseCount, VariableCount + 1);
+			for(COUNTER v=0; v<VariableCount; v++){
+				memcpy(R.Columns.getColumn(v), CasesX[v], CaseCount*sizeof(double));
+				R.X[v] = R.Columns.getColumn(v);
+			}
+			memcpy(R.Columns.getColumn(VariableCount), CasesY, CaseCount*sizeof(double));
+			InterlockedExchange(&R.Ready, 1);
+		}
+		ReplicaLock.Unlock();
+	}
+	return R;
+}
+
+
+/*******************************
+Budget Methods
+*******************************/
+void CEvaluatingFunction::setBudget(bool Timed, DWORD Milliseconds, double Nodes, double Cases){
+	HasDeadline = Timed;
+	Deadline = GetTickCount() + Milliseconds;
+	NodeLimit = Nodes;
+	CaseLimit = Cases;
+}
+
+bool CEvaluatingFunction::isCancelled(){
+
+	if(Running && !*Running) return true;
+	if(Stop && *Stop){
+		if(Running) *Running = false;
+		return true;
+	}
+
+	LONG Spent = BUDGET_NONE;
+	if(HasDeadline && ((LONG)(GetTickCount() - Deadline) >= 0)) Spent = BUDGET_TIME;
+	else if((NodeLimit > 0.0f) && (TotalNodeEvaluations >= NodeLimit)) Spent = BUDGET_NODES;
+	else if((CaseLimit > 0.0f) && (TotalCaseEvaluations >= CaseLimit)) Spent = BUDGET_CASES;
+	if(Spent == BUDGET_NONE) return false;
+
+	InterlockedCompareExchange(&BudgetSpent, Spent, BUDGET_NONE);
+	if(Running) *Running = false;
+	return true;
 }
 
 
@@ -64,24 +129,52 @@ F<double> CEvaluatingFunction::Eval(F<double> Xval){
 
 }
 
+void CEvaluatingFunction::setTable(const CCaseTable* T){
+	Table = T;
+	VariableCount = T ? T->getVariableCount() : 1;
+	destroyPoints();
+}
+
 void CEvaluatingFunction::generatePoints(COUNTER FitCaseNum){
 
+		if(Table){
+			//A table never changes, so its grades stay valid from one generation to the next
+			if(CaseCount) return;
+			destroyPoints();
+			CaseVersion++;
+			for(COUNTER v=0; v<VariableCount; v++)
+				CasesX[v] = Table->getX(v);
+			CasesY = Table->getY();
+			CaseCount = Table->getRowCount();
+			return;
+		}
+
 		F<double> IntervalSize = (RangeMax-RangeMin)/(double)FitCaseNum;
 		destroyPoints();
+		CaseVersion++;
 		try{
-			FunctionX1.push_back(RangeMin);
-			FunctionY.push_back(Eval(RangeMin));
+			vector<double> FunctionX1;
+			vector<double> FunctionY;
+			FunctionX1.push_back(RangeMin.x());
+			FunctionY.push_back(Eval(RangeMin).x());
 			for(COUNTER i=1; i<FitCaseNum-1; i++){
 			
 				F<double> x = RangeMin + ((F<double>)i*IntervalSize);	//Pick a point 
-				int somewhere = rand()%100;		//in the interval,
+				int somewhere = CRandom::current().below(100);		//in the interval,
 				if (somewhere) x+= ((F<double>)1.0f/(F<double>)(somewhere))*IntervalSize;	//somewhere in the interval.
 			
-				FunctionX1.push_back(x);
-				FunctionY.push_back(Eval(x));
+				FunctionX1.push_back(x.x());
+				FunctionY.push_back(Eval(x).x());
 			}
-			FunctionX1.push_back(RangeMax);
-			FunctionY.push_back(Eval(RangeMax));
+			FunctionX1.push_back(RangeMax.x());
+			FunctionY.push_back(Eval(RangeMax).x());
+
+			CaseCount = (COUNTER)FunctionX1.size();
+			Function.resize(CaseCount, 2);
+			memcpy(Function.getColumn(0), &FunctionX1[0], CaseCount*sizeof(double));
+			memcpy(Function.getColumn(1), &FunctionY[0], CaseCount*sizeof(double));
+			CasesX[0] = Function.getColumn(0);
+			CasesY = Function.getColumn(1);
 		}
 		catch(CString Exc){
 
@@ -90,25 +183,201 @@ void CEvaluatingFunction::generatePoints(COUNTER FitCaseNum){
 		}
 }
 
-double CEvaluatingFunction::EvaluateCDNA(CDNAStatement* Stat){
+void CCompiledStatement::compile(const CDNAStatement& S, const CRationalForm* Built){
+	//Throws "UNDEF" like CDNAStatement::Eval
+	if(Built) Form = *Built;
+	bool HasForm = Built ? Form.isValid() : Form.compile(S);
+	Plan.compile(S);
+	UseForm = HasForm && (Form.getCost() <= Plan.getCaseCost());
+	CaseCost = UseForm ? Form.getCost() : Plan.getCaseCost();
+}
+
+void CEvaluatingFunction::EvaluateCases(CCompiledStatement& C, const double* const* X, const double* Y, 
+					COUNTER Count, CCaseErrors& Errors){
+	//Adds the absolute errors of C over the given cases to Errors, X[v]
+	//the column of X_v+1 and Y of the target from the first case on.
+	//Throws "UNDEF" if C is undefined on one of them, and "CANCELLED"
+	//if the run is stopped before the last block.
+	double diff;
+	if(C.UseForm){
+		for(COUNTER i =0; i<Count;i++){
+			if(!(i % PLANBLOCK) && isCancelled()) throw CString(_T("CANCELLED"));
+			diff = fabs(Y[i] - C.Form.Eval(X[0][i]));
+			Errors.addError(diff);
+			if(diff <= TOL_0) Errors.Hits++;
+		}
+	}
+	else{
+		double Out[PLANBLOCK];
+		const double* Block[MAXVARIABLES];
+		for(COUNTER Beg = 0; Beg < Count; Beg += PLANBLOCK){
+			if(isCancelled()) throw CString(_T("CANCELLED"));
+			COUNTER BlockCount = (Count - Beg < PLANBLOCK) ? Count - Beg : PLANBLOCK;
+			for(COUNTER v=0; v<VariableCount; v++)
+				Block[v] = X[v] + Beg;
+			C.Plan.run(Block, BlockCount, Out);
+			for(COUNTER i =0; i<BlockCount;i++){
+				diff = fabs(Y[Beg+i] - Out[i]);
+				Errors.addError(diff);
+				if(diff <= TOL_0) Errors.Hits++;
+			}
+		}
+	}
+	Errors.Cases += Count;
+
+	CounterLock.Lock();
+	NodeEvaluations += (unsigned __int64)C.CaseCost*Count;
+	if(C.Plan.getTreeSize() > C.CaseCost)
+		NodeEvaluationsSaved += (unsigned __int64)(C.Plan.getTreeSize() - C.CaseCost)*Count;
+	TotalNodeEvaluations += (double)C.CaseCost*Count;
+	TotalCaseEvaluations += (double)Count;
+	CounterLock.Unlock();
+}
+
+void CEvaluatingFunction::getCases(const double* const*& X, const double*& Y){
+	//Workers of a NUMA pool read their own node's copy of the cases,
+	//except for a mapped table, which is read in place
+	int Node = CThreadPool::getCurrentNode();
+	if((Node >= 0) && getCaseCount() && !(Table && Table->isMapped())){
+		const CCaseReplica& R = getReplica((COUNTER)Node);
+		X = R.X;
+		Y = R.Columns.getColumn(VariableCount);
+	}
+	else{
+		X = getCasesX();
+		Y = getCasesY();
+	}
+}
+
+
+/*******************************
+Block task: runs a copy of a compiled
+individual over a run of case blocks,
+each into its own partial errors.
+*******************************/
+class CCaseBlockTask : public CPoolTask
+{
+	CEvaluatingFunction& EvalFunc;
+	const CCompiledStatement& Compiled;
+	vector<CCaseErrors>& Partials;
+	COUNTER Beg, End;
+	volatile bool& Undefined;
+
+public:
+	CCaseBlockTask(CEvaluatingFunction& Eval, const CCompiledStatement& C, vector<CCaseErrors>& P,
+		COUNTER b, COUNTER e, volatile bool& U):
+	EvalFunc(Eval), Compiled(C), Partials(P), Beg(b), End(e), Undefined(U){};
+
+	void run(COUNTER Worker){
+		//Plans keep their scratch rows, so every task runs its own copy
+		CCompiledStatement C(Compiled);
+		const double* const* X;
+		const double* Y;
+		EvalFunc.getCases(X, Y);
+
+		COUNTER Count = EvalFunc.getCaseCount();
+		const double* Inputs[MAXVARIABLES];
+		for(COUNTER b=Beg; (b<End)&&(!Undefined); b++){
+			COUNTER First = b*CASEBLOCK;
+			COUNTER BlockCount = (Count - First < CASEBLOCK) ? Count - First : CASEBLOCK;
+			for(COUNTER v=0; v<EvalFunc.getVariableCount(); v++)
+				Inputs[v] = X[v] + First;
+			try{
+				EvalFunc.EvaluateCases(C, Inputs, &Y[First], BlockCount, Partials[b]);
+			}
+			catch(CString Mess){
+				if(Mess == CString(_T("UNDEF"))) Undefined = true;
+				throw Mess;
+			}
+		}
+	}
+};
+
+void CEvaluatingFunction::EvaluateBlocks(const CCompiledStatement& C, CThreadPool* Pool, CCaseErrors& Errors){
+	//Compensated partial errors of fixed blocks are summed pairwise in a fixed
+	//order, so the grade does not depend on the pool or on which worker ran a block.
+	//Throws "UNDEF" like EvaluateCases.
+	COUNTER Count = getCaseCount();
+	COUNTER Blocks = (Count + CASEBLOCK - 1)/CASEBLOCK;
+	if(!Blocks) return;
+
+	vector<CCaseErrors> Partials(Blocks);
+	volatile bool Undefined = false;
+
+	COUNTER TaskCount = Pool ? Pool->getWorkerCount()*TASKSPERWORKER : 1;
+	if(TaskCount > Blocks) TaskCount = Blocks;
+
+	vector<CCaseBlockTask*> Tasks;
+	for(COUNTER t=0; t<TaskCount; t++)
+		Tasks.push_back(new CCaseBlockTask(*this, C, Partials,
+			(COUNTER)(((unsigned __int64)t*Blocks)/TaskCount),
+			(COUNTER)(((unsigned __int64)(t+1)*Blocks)/TaskCount), Undefined));
+
+	try{
+		if(!Pool)
+			Tasks[0]->run(0);
+		else{
+			CTaskGroup Batch(*Pool);
+			for(COUNTER t=0; t<TaskCount; t++)
+				Batch.run(Tasks[t]);
+			Batch.wait();
+		}
+	}
+	catch(CString Mess){
+		for(COUNTER t=0; t<Tasks.size(); t++)
+			delete Tasks[t];
+		throw Mess;
+	}
+	for(COUNTER t=0; t<Tasks.size(); t++)
+		delete Tasks[t];
+
+	for(COUNTER Step=1; Step<Blocks; Step*=2)
+		for(COUNTER i=0; i+Step<Blocks; i+=2*Step)
+			Partials[i].add(Partials[i+Step]);
+	Errors.add(Partials[0]);
+}
+
+double CEvaluatingFunction::EvaluateCDNA(CDNAStatement* Stat, CThreadPool* Pool, const CRationalForm* Built){
 	
 	double Grade = 0.0f;
-	double diff;
 	Stat->Fitness->reset();
 
+	//Survivors and unchanged children are not run again on the same cases
+	unsigned __int64 Hash = Stat->getHash();
+	int Hits = 0;
+	if(Memo.find(Hash, CaseVersion, Grade, Hits)){
+		Stat->Fitness->setStandardizedFitness(Grade);
+		Stat->Fitness->setHits(Hits);
+		return Grade;
+	}
+
 	try{
-		for(COUNTER i =0; i<this->FunctionX1.size();i++){
-			diff = fabs((this->FunctionY[i]-(Stat->Eval(this->FunctionX1[i]))).x());
-			Grade += diff;
-			if(diff <= TOL_0) Stat->Fitness->addHit();
+		//The individual runs either as its rational normal form (Horner) or
+		//as its evaluation plan, whichever costs fewer operations per case.
+		CCompiledStatement C;
+		C.compile(*Stat, Built);
+
+		CCaseErrors Errors;
+		if(getCaseCount() >= SPLITCASECOUNT)
+			EvaluateBlocks(C, Pool, Errors);
+		else{
+			const double* const* X;
+			const double* Y;
+			getCases(X, Y);
+			EvaluateCases(C, X, Y, getCaseCount(), Errors);
 		}
+		Grade = Errors.getSum();
 		
 		Stat->Fitness->setStandardizedFitness(Grade);
+		Stat->Fitness->setHits(Errors.Hits);
+		Memo.store(Hash, CaseVersion, Grade, Errors.Hits);
 	}
 	catch(CString Mess){
-		if(Mess == CString(_T("UNDEF"))){
+		//A cancelled individual is left ungraded: the run is stopping
+		if((Mess == CString(_T("UNDEF"))) || (Mess == CString(_T("CANCELLED")))){
 			Grade = INFINITY_GRADE;
 			Stat->Fitness->setStandardizedFitness(INFINITY_GRADE);
+			if(Mess == CString(_T("UNDEF"))) Memo.store(Hash, CaseVersion, Grade, 0);
 		}
 		else{
 			Mess += _T("\r\n -->At CEvaluatingFunction::EvaluateCDNA");
@@ -118,19 +387,45 @@ double CEvaluatingFunction::EvaluateCDNA(CDNAStatement* Stat){
 	
 	return Grade;
 }
+bool CEvaluatingFunction::recallGrade(CDNAStatement* Stat){
+	double Grade;
+	int Hits = 0;
+	if(!Memo.find(Stat->getHash(), CaseVersion, Grade, Hits)) return false;
+	Stat->Fitness->reset();
+	Stat->Fitness->setStandardizedFitness(Grade);
+	Stat->Fitness->setHits(Hits);
+	return true;
+}
+
+void CEvaluatingFunction::setGrade(CDNAStatement* Stat, const CCaseErrors& Errors, bool Undefined, double Cases){
+	//For cases run outside EvaluateCDNA, e.g. streamed, and remembered alike. Over
+	//that many cases an error sum passes INFINITY_GRADE, so an undefined individual
+	//is graded INFINITY_GRADE per case and never beats a defined one
+	double Grade = Undefined ? INFINITY_GRADE*(Cases > 1.0f ? Cases : 1.0f) : Errors.getSum();
+	int Hits = Undefined ? 0 : (int)Errors.Hits;
+	Stat->Fitness->reset();
+	Stat->Fitness->setStandardizedFitness(Grade);
+	Stat->Fitness->setHits(Hits);
+	Memo.store(Stat->getHash(), CaseVersion, Grade, Hits);
+}
+
 /****************************
 Drawing Routines
 ****************************/
 
 void CEvaluatingFunction::draw(){
+	ASSERT(CaseCount > 2);
+	drawPoints(CasesX[0], CasesY, CaseCount);
+}
+
+void CEvaluatingFunction::drawPoints(const double* X, const double* Y, COUNTER Count){
 
 	glColor3f(1.0f, 0.0f, 0.0f);
-	ASSERT(this->FunctionX1.size() > 2);
-	for(COUNTER i=0; i<this->FunctionX1.size()-1;i++){
+	for(COUNTER i=0; i+1<Count;i++){
 		glBegin(GL_LINES);
 			
-				glVertex3f(FunctionX1[i].x(), FunctionY[i].x(), 0.0f);
-				glVertex3f(FunctionX1[i+1].x(), FunctionY[i+1].x(), 0.0f);
+				glVertex3f((GLfloat) X[i], (GLfloat) Y[i], 0.0f);
+				glVertex3f((GLfloat) X[i+1], (GLfloat) Y[i+1], 0.0f);
 
 		glEnd();
 	}
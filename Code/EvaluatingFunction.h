@@ -1,15 +1,101 @@
 #pragma once
 #include "afx.h"
+#include "RationalForm.h"
+#include "EvalPlan.h"
+#include "ThreadPool.h"
+#include "FitnessMemo.h"
+#include "CaseColumns.h"
+
+#define CASEBLOCK (64*PLANBLOCK)
+//Fitness cases per partial error sum when an individual is graded block by block
+
+#define SPLITCASECOUNT (4*CASEBLOCK)
+//Case count from which individuals are graded block by block
 
 class CDNAStatement;
+class CCaseTable;
+
+enum EVALBUDGET{
+	BUDGET_NONE = 0,
+	BUDGET_TIME,			//wall-clock seconds of the run
+	BUDGET_NODES,			//node evaluations of the run
+	BUDGET_CASES,			//case evaluations of the run
+};
+
+/*******************************
+Error totals over a range of
+fitness cases. The error sum is
+compensated (Neumaier): Carry holds
+what rounding dropped from Sum.
+*******************************/
+struct CCaseErrors{
+	double Sum;
+	double Carry;
+	double SumSq;
+	COUNTER Hits;
+	COUNTER Cases;
+
+	CCaseErrors(): Sum(0.0f), Carry(0.0f), SumSq(0.0f), Hits(0), Cases(0){};
+
+	void addSum(double Value){
+		double Total = Sum + Value;
+		if(Total - Total == 0.0f)		//an infinite sum has nothing to compensate
+			Carry += (fabs(Sum) >= fabs(Value)) ? (Sum - Total) + Value : (Value - Total) + Sum;
+		Sum = Total;
+	};
+	void addError(double Error){ addSum(Error); SumSq += Error*Error; };
+	void add(const CCaseErrors& E){ addSum(E.Sum); Carry += E.Carry; SumSq += E.SumSq; Hits += E.Hits; Cases += E.Cases; };
+	double getSum() const { return Sum + Carry; };
+};
+
+/*******************************
+An individual ready to be run over
+fitness cases: its rational normal
+form or its evaluation plan, whichever
+is cheaper per case.
+*******************************/
+class CCompiledStatement{
+public:
+	CRationalForm Form;
+	CEvalPlan Plan;
+	bool UseForm;
+	COUNTER CaseCost;
+
+	CCompiledStatement(): UseForm(false), CaseCost(0){};
+	void compile(const CDNAStatement& S, const CRationalForm* Built = NULL);	//Built: S's form compiled by the caller
+};
+
+/*******************************
+Copy of the fitness cases for the
+pool workers of one NUMA node, made
+by the first of them that needs it.
+*******************************/
+struct CCaseReplica{
+	CCaseColumns Columns;				//the inputs, then the target
+	const double* X[MAXVARIABLES];
+	volatile LONG Ready;
+
+	CCaseReplica(): Ready(0){};
+};
 
 class CEvaluatingFunction :
 	public CObject
 {
 	
 protected:
-	vector< F<double> > FunctionY;
-	vector< F<double> > FunctionX1;
+	CCaseColumns Function;				//cases of the built-in target: X_1, then Y
+
+	//The cases evaluated, column by column: Function or the rows of a table
+	const CCaseTable* Table;
+	COUNTER VariableCount;
+	const double* CasesX[MAXVARIABLES];
+	const double* CasesY;
+	COUNTER CaseCount;
+
+	//Per node copies of the cases, dropped whenever the cases change
+	CCaseReplica Replicas[MAXNUMANODES];
+	CCriticalSection ReplicaLock;
+	const CCaseReplica& getReplica(COUNTER Node);
 
 	void destroyPoints();
 	F<double> RangeMin;
@@ -18,6 +104,27 @@ protected:
 	F<double> makeBehave(F<double> y);
 	F<double> Eval(F<double> Xval);
 	
+	//Node evaluations spent and avoided since the last resetCounters;
+	//EvaluateCases may run on several pool workers at once
+	unsigned __int64 NodeEvaluations;
+	unsigned __int64 NodeEvaluationsSaved;
+	CCriticalSection CounterLock;
+
+	//Cooperative cancellation, checked before every block of cases. The totals
+	//are never reset and are read without the lock: an aligned double is read whole
+	volatile bool* Running;				//of the run, cleared here once a budget is spent
+	const volatile LONG* Stop;			//set from outside the run, e.g. by another process; NULL for none
+	bool HasDeadline;
+	DWORD Deadline;						//GetTickCount
+	double NodeLimit;					//0 for none
+	double CaseLimit;
+	double TotalNodeEvaluations;
+	double TotalCaseEvaluations;
+	volatile LONG BudgetSpent;			//EVALBUDGET that stopped the run
+
+	//Grades on the current cases, looked up by EvaluateCDNA before running a tree
+	CFitnessMemo Memo;
+	COUNTER CaseVersion;				//bumped by generatePoints
 	
 public:
 
@@ -26,9 +133,35 @@ public:
 	CEvaluatingFunction(double=-1.0f, double=1.0f);
 	~CEvaluatingFunction(void);
 
-	double EvaluateCDNA(CDNAStatement*);
-	void generatePoints(COUNTER FitCaseNum);
+	double EvaluateCDNA(CDNAStatement*, CThreadPool* Pool = NULL, const CRationalForm* Built = NULL);	//blocks of cases split over Pool if given
+	bool recallGrade(CDNAStatement* Stat);		//from the memo, false if it is not there
+	void setGrade(CDNAStatement* Stat, const CCaseErrors& Errors, bool Undefined, double Cases);	//of cases the caller ran
+	void EvaluateCases(CCompiledStatement& C, const double* const* X, const double* Y, COUNTER Count, CCaseErrors& Errors);
+	void EvaluateBlocks(const CCompiledStatement& C, CThreadPool* Pool, CCaseErrors& Errors);
+	void getCases(const double* const*& X, const double*& Y);		//for the calling thread
+	void generatePoints(COUNTER FitCaseNum);		//all the rows of the table if one is set
+	void setTable(const CCaseTable* T);			//NULL for the built-in target
 	void draw();
+	static void drawPoints(const double* X, const double* Y, COUNTER Count);		//cases and axes
+
+	void resetCounters(){ NodeEvaluations = 0; NodeEvaluationsSaved = 0; };
+	unsigned __int64 getNodeEvaluations() const { return NodeEvaluations; };
+	unsigned __int64 getNodeEvaluationsSaved() const { return NodeEvaluationsSaved; };
+
+	//Evaluations throw "CANCELLED" once the flag is cleared or a budget is spent
+	void setCancel(volatile bool* R){ Running = R; };
+	void setStop(const volatile LONG* S){ Stop = S; };		//clears the run's flag too once set
+	void setBudget(bool Timed, DWORD Milliseconds, double Nodes, double Cases);
+	bool isCancelled();
+	EVALBUDGET getBudgetSpent() const { return (EVALBUDGET)BudgetSpent; };
+	double getTotalNodeEvaluations() const { return TotalNodeEvaluations; };
+	double getTotalCaseEvaluations() const { return TotalCaseEvaluations; };
+	void getMemoCounts(unsigned __int64& Lookups, unsigned __int64& Found){ Memo.getCounts(Lookups, Found); };
+
+	COUNTER getCaseCount() const { return CaseCount; };
+	COUNTER getVariableCount() const { return VariableCount; };
+	const double* const* getCasesX() const { return CasesX; };		//[0] is the column of X_1
+	const double* getCasesY() const { return CasesY; };
 	
 		
 };
@@ -1,47 +1,15 @@
 #include "StdAfx.h"
+#include "DNAStatement.h"
 #include ".\fitnessclass.h"
 
-/*******************************
-Static Methods
-*******************************/
-
-double CFitnessClass::UpdateTotalStandardizedFitness(double change){
-	static double Total = 0.0f;
-	Total += change;
-	return Total;
-}
-
-double CFitnessClass::UpdateTotalAdjustedFitness(double change){
-	static double Total = 0.0f;
-	Total += change;
-	return Total;
-}
-
-double CFitnessClass::UpdateTotalNormalizedFitness(double change){
-	static double Total = 0.0f;
-	Total += change;
-	return Total;
-}
-
-
 void CFitnessClass::reset(){
 	
-	UpdateTotalStandardizedFitness(-1.0f*standardizedFitness);
-	UpdateTotalAdjustedFitness(-1.0f*adjustedFitness);
-	UpdateTotalNormalizedFitness(-1.0f*normalizedFitness);
-
 	standardizedFitness = 0.0f;
 	adjustedFitness = 0.0f;
 	normalizedFitness = 0.0f;
 	hits = 0;
 }
 void CFitnessClass::copy(const CFitnessClass& S){
-	reset();
-
-	UpdateTotalStandardizedFitness(S.standardizedFitness);
-	UpdateTotalAdjustedFitness(S.adjustedFitness);
-	UpdateTotalNormalizedFitness(S.normalizedFitness);
-
 	standardizedFitness = S.standardizedFitness;
 	adjustedFitness = S.adjustedFitness;
 	normalizedFitness = S.normalizedFitness;
@@ -66,7 +34,6 @@ const CFitnessClass& CFitnessClass::operator=(const CFitnessClass& S){
 	return *this;
 }
 CFitnessClass::~CFitnessClass(void){
-	reset();	
 }
 
 /********************
@@ -77,10 +44,7 @@ void CFitnessClass::setStandardizedFitness(double Fit){
 	reset();
 	this->standardizedFitness = Fit;	
 	if(Fit >=0.0f){
-		UpdateTotalStandardizedFitness(Fit);
-		double AdjustFit = 1.0f / (standardizedFitness + 1.0f);
-		UpdateTotalAdjustedFitness(AdjustFit);
-		this->adjustedFitness = AdjustFit;
+		this->adjustedFitness = 1.0f / (standardizedFitness + 1.0f);
 	}
 	else{
 		CString Msg;
@@ -90,24 +54,75 @@ void CFitnessClass::setStandardizedFitness(double Fit){
 }
 
 
-void CFitnessClass::normalizeFitness(){
+void CFitnessClass::normalizeFitness(double TotalAdjustedFitness){
 
-	if(getTotalAdjustedFitness() > 0.0f){
-		double NormFit = ((10.0f)*adjustedFitness) / getTotalAdjustedFitness(); 
-		UpdateTotalNormalizedFitness((-1.0f*normalizedFitness) + NormFit);	
-		this->normalizedFitness = NormFit;
-	}
+	if(TotalAdjustedFitness > 0.0f)
+		this->normalizedFitness = ((10.0f)*adjustedFitness) / TotalAdjustedFitness; 
 }
 
 
+/*******************************
+Fitness Summary Methods
+*******************************/
+CFitnessSummary::CFitnessSummary(){
+	reset();
+}
 
+void CFitnessSummary::reset(){
+	TotalStandardizedFitness = 0.0f;
+	TotalAdjustedFitness = 0.0f;
+	TotalNormalizedFitness = 0.0f;
+	Count = 0;
+}
 
+void CFitnessSummary::add(const CFitnessClass& F){
+	TotalStandardizedFitness += F.getStandardizedFitness();
+	TotalAdjustedFitness += F.getAdjustedFitness();
+	TotalNormalizedFitness += F.getNormalizedFitness();
+	Count++;
+}
 
+void CFitnessSummary::merge(const CFitnessSummary& S){
+	TotalStandardizedFitness += S.TotalStandardizedFitness;
+	TotalAdjustedFitness += S.TotalAdjustedFitness;
+	TotalNormalizedFitness += S.TotalNormalizedFitness;
+	Count += S.Count;
+}
 
+static double pairwiseSum(vector<double>& Values){
+	//Sums in place along a tree fixed by the count alone
+	if(Values.empty()) return 0.0f;
+	for(COUNTER Step=1; Step<Values.size(); Step*=2)
+		for(COUNTER i=0; i+Step<Values.size(); i+=2*Step)
+			Values[i] += Values[i+Step];
+	return Values[0];
+}
 
+void CFitnessSummary::reduce(const vector<CDNAStatement*>& Population){
+	//Pairwise in population order, so the totals do not depend on who graded what
+	reset();
+	vector<double> Standardized, Adjusted, Normalized;
+	for(COUNTER i=0; i<Population.size(); i++){
+		if(!Population[i]) continue;
+		Standardized.push_back(Population[i]->Fitness->getStandardizedFitness());
+		Adjusted.push_back(Population[i]->Fitness->getAdjustedFitness());
+		Normalized.push_back(Population[i]->Fitness->getNormalizedFitness());
+	}
+	TotalStandardizedFitness = pairwiseSum(Standardized);
+	TotalAdjustedFitness = pairwiseSum(Adjusted);
+	TotalNormalizedFitness = pairwiseSum(Normalized);
+	Count = (COUNTER)Standardized.size();
+}
 
+void CFitnessSummary::normalize(const vector<CDNAStatement*>& Population){
+	//Called once every individual is graded
+	reduce(Population);
 
-
-
-
-
+	vector<double> Normalized;
+	for(COUNTER i=0; i<Population.size(); i++){
+		if(!Population[i]) continue;
+		Population[i]->Fitness->normalizeFitness(TotalAdjustedFitness);
+		Normalized.push_back(Population[i]->Fitness->getNormalizedFitness());
+	}
+	TotalNormalizedFitness = pairwiseSum(Normalized);
+}
@@ -9,17 +9,9 @@ class CFitnessClass
 	int hits;
 
 	void copy(const CFitnessClass& S);
-
-	static double UpdateTotalStandardizedFitness(double);
-	static double UpdateTotalAdjustedFitness(double);
-	static double UpdateTotalNormalizedFitness(double);
 	
 	public:
 
-		static double getTotalStandardizedFitness(){return UpdateTotalStandardizedFitness(0.0f);};
-		static double getTotalAdjustedFitness(){return UpdateTotalAdjustedFitness(0.0f);};
-		static double getTotalNormalizedFitness(){return UpdateTotalNormalizedFitness(0.0f);};
-		
 	int getHits(){return hits;};
 		CFitnessClass(void);
 		CFitnessClass(const CFitnessClass& S);
@@ -34,6 +26,32 @@ class CFitnessClass
 		
 
 		void setStandardizedFitness(double);
-		void normalizeFitness();
+		void normalizeFitness(double TotalAdjustedFitness);
 		void addHit(){hits++;};
+		void setHits(int h){hits = h;};
+};
+
+
+class CDNAStatement;
+
+/*******************************
+Fitness totals of a population,
+reduced over its individuals once
+they have all been graded.
+*******************************/
+class CFitnessSummary
+{
+public:
+	double TotalStandardizedFitness;
+	double TotalAdjustedFitness;
+	double TotalNormalizedFitness;
+	COUNTER Count;
+
+	CFitnessSummary();
+	void reset();
+	void add(const CFitnessClass& F);
+	void merge(const CFitnessSummary& S);
+
+	void reduce(const vector<CDNAStatement*>& Population);
+	void normalize(const vector<CDNAStatement*>& Population);
 };
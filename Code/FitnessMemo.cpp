@@ -0,0 +1,56 @@
+#include "StdAfx.h"
+#include ".\fitnessmemo.h"
+
+
+CFitnessMemo::CFitnessMemo(){
+	CEntry Empty;
+	Empty.Hash = 0;
+	Empty.Version = 0;
+	Empty.Grade = 0.0f;
+	Empty.Hits = 0;
+
+	for(COUNTER s=0; s<MEMOSTRIPES; s++){
+		Stripes[s].Entries.assign(MEMOCAPACITY / MEMOSTRIPES, Empty);
+		Stripes[s].Lookups = 0;
+		Stripes[s].Found = 0;
+	}
+}
+
+bool CFitnessMemo::find(unsigned __int64 Hash, COUNTER Version, double& Grade, int& Hits){
+	//Grades of older case sets are stale, their slots count as empty
+	CStripe& S = getStripe(Hash);
+	bool Known = false;
+	S.Lock.Lock();
+	const CEntry& E = S.Entries[getSlot(Hash)];
+	S.Lookups++;
+	if((E.Version == Version) && (E.Hash == Hash)){
+		Grade = E.Grade;
+		Hits = E.Hits;
+		S.Found++;
+		Known = true;
+	}
+	S.Lock.Unlock();
+	return Known;
+}
+
+void CFitnessMemo::store(unsigned __int64 Hash, COUNTER Version, double Grade, int Hits){
+	CStripe& S = getStripe(Hash);
+	S.Lock.Lock();
+	CEntry& E = S.Entries[getSlot(Hash)];
+	E.Hash = Hash;
+	E.Version = Version;
+	E.Grade = Grade;
+	E.Hits = Hits;
+	S.Lock.Unlock();
+}
+
+void CFitnessMemo::getCounts(unsigned __int64& Lookups, unsigned __int64& Found){
+	Lookups = 0;
+	Found = 0;
+	for(COUNTER s=0; s<MEMOSTRIPES; s++){
+		Stripes[s].Lock.Lock();
+		Lookups += Stripes[s].Lookups;
+		Found += Stripes[s].Found;
+		Stripes[s].Lock.Unlock();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#define MEMOSTRIPES 64
+//Locks of the fitness memo: workers grading different trees rarely share one
+
+#define MEMOCAPACITY 32768
+//Grades the fitness memo holds, a newer grade overwrites the one in its slot
+
+
+/*******************************
+Grades of trees already run on the
+current fitness cases, keyed by the
+structural hash of the tree and the
+version of the case set. Fixed size
+and direct mapped, so it never grows;
+each stripe of slots has its own lock.
+*******************************/
+class CFitnessMemo
+{
+	struct CEntry{
+		unsigned __int64 Hash;
+		COUNTER Version;				//0 for a slot never stored
+		double Grade;					//standardized fitness
+		int Hits;
+	};
+
+	struct CStripe{
+		CCriticalSection Lock;
+		vector<CEntry> Entries;
+		unsigned __int64 Lookups;
+		unsigned __int64 Found;
+	};
+
+	CStripe Stripes[MEMOSTRIPES];
+
+	CStripe& getStripe(unsigned __int64 Hash){ return Stripes[Hash % MEMOSTRIPES]; };
+	static COUNTER getSlot(unsigned __int64 Hash){ return (COUNTER)((Hash / MEMOSTRIPES) % (MEMOCAPACITY / MEMOSTRIPES)); };
+
+public:
+	CFitnessMemo();
+
+	bool find(unsigned __int64 Hash, COUNTER Version, double& Grade, int& Hits);
+	void store(unsigned __int64 Hash, COUNTER Version, double Grade, int Hits);
+	void getCounts(unsigned __int64& Lookups, unsigned __int64& Found);		//since construction
+};
@@ -7,6 +7,21 @@ LPCTSTR CFunctionSet::TreeTag(GENEStatementType S){
 	TOSTRING(S, UNDEF);
 
 	TOSTRING(S, X_1);
+	TOSTRING(S, X_2);
+	TOSTRING(S, X_3);
+	TOSTRING(S, X_4);
+	TOSTRING(S, X_5);
+	TOSTRING(S, X_6);
+	TOSTRING(S, X_7);
+	TOSTRING(S, X_8);
+	TOSTRING(S, X_9);
+	TOSTRING(S, X_10);
+	TOSTRING(S, X_11);
+	TOSTRING(S, X_12);
+	TOSTRING(S, X_13);
+	TOSTRING(S, X_14);
+	TOSTRING(S, X_15);
+	TOSTRING(S, X_16);
 	TOSTRING(S, N_1);
 	TOSTRING(S, N_2);
 	TOSTRING(S, N_3);
@@ -40,6 +55,21 @@ unsigned int CFunctionSet::Arity(GENEStatementType S){
     switch(S){
 	case UNDEF:
 	case X_1:
+	case X_2:
+	case X_3:
+	case X_4:
+	case X_5:
+	case X_6:
+	case X_7:
+	case X_8:
+	case X_9:
+	case X_10:
+	case X_11:
+	case X_12:
+	case X_13:
+	case X_14:
+	case X_15:
+	case X_16:
 	case N_1:
 	case N_2:
 	case N_3:
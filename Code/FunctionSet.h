@@ -1,13 +1,30 @@
 #pragma once
 
+#include "Random.h"
+
 
 
 enum GENEStatementType{ 
     
     UNDEF = 0,
 
-    //Terminals
+    //Terminals: the input variables, then the constants
     X_1,
+    X_2,
+    X_3,
+    X_4,
+    X_5,
+    X_6,
+    X_7,
+    X_8,
+    X_9,
+    X_10,
+    X_11,
+    X_12,
+    X_13,
+    X_14,
+    X_15,
+    X_16,
     N_1,
     N_2,
     N_3,
@@ -24,6 +41,13 @@ enum GENEStatementType{
 #define BEGTERM (unsigned int) X_1
 #define ENDTERM (unsigned int) N_5
 
+#define BEGVAR (unsigned int) X_1
+#define ENDVAR (unsigned int) X_16
+#define BEGCONST (unsigned int) N_1
+
+#define MAXVARIABLES (ENDVAR + 1 - BEGVAR)
+//Input variables a run may use, X_1 to X_16
+
 #define BEGFUNC (unsigned int) PLUS
 #define ENDFUNC (unsigned int) MULT
 
@@ -58,14 +82,26 @@ class CFunctionSet{
                     &&((unsigned int)T<=ENDTERM));              
               };
          
-        static GENEStatementType getRandTerminal(){
-                    unsigned int FuncNums = (ENDTERM + 1) - BEGTERM;
-                    return (GENEStatementType)((rand()%FuncNums)+ BEGTERM);
+        static bool isVariable(GENEStatementType T){
+                    return (((unsigned int)T>=BEGVAR)
+                    &&((unsigned int)T<=ENDVAR));
+              };
+        static COUNTER getVariable(GENEStatementType T){
+                    //Column of the input a variable reads, 0 for X_1
+                    return (COUNTER)T - BEGVAR;
+              };
+
+        static GENEStatementType getRandTerminal(COUNTER Variables = 1){
+                    //One of X_1..X_Variables or a constant, all equally likely
+                    unsigned int FuncNums = Variables + (ENDTERM + 1) - BEGCONST;
+                    unsigned int Pick = CRandom::current().below(FuncNums);
+                    if(Pick < Variables) return (GENEStatementType)(Pick + BEGVAR);
+                    return (GENEStatementType)(Pick - Variables + BEGCONST);
               };
               
         static GENEStatementType getRandFunction(){
                     unsigned int FuncNums = (ENDFUNC + 1) - BEGFUNC;
-                    return (GENEStatementType)((rand()%FuncNums)+ BEGFUNC);    
+                    return (GENEStatementType)(CRandom::current().below(FuncNums)+ BEGFUNC);    
               };
 
         static bool isSameFunctionTypeClass(GENEStatementType T1, GENEStatementType T2){
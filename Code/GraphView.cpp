@@ -225,14 +225,20 @@ void GraphView::RenderScene(){
 	glScalef(Scalefactor, Scalefactor, Scalefactor);
 
 	try{
-		if(DocPtr->EvalFunc)
-			DocPtr->EvalFunc->draw();
-		
-		glColor3f(0.0f, 0.0f, 1.0f);
-		DocPtr->m_Population[DocPtr->m_BestIndex]->draw(60, DocPtr->RangeMin, DocPtr->RangeMax);
-
-		glColor3f(0.7f, 0.6f, 0.2f);
-		DocPtr->m_Population[DocPtr->m_CurrentIndividual]->draw(60, DocPtr->RangeMin, DocPtr->RangeMax);
+		const CRunSnapshot* Shown = DocPtr->m_Snapshot;
+		if(Shown){
+			Shown->drawCases();
+			
+			glColor3f(0.0f, 0.0f, 1.0f);
+			if(Shown->BestSoFar)
+				Shown->drawIndividual(Shown->BestSoFar);
+			else if(Shown->Individuals[Shown->BestIndex])
+				Shown->drawIndividual(Shown->Individuals[Shown->BestIndex]);
+
+			glColor3f(0.7f, 0.6f, 0.2f);
+			if(Shown->Individuals[DocPtr->m_CurrentIndividual])
+				Shown->drawIndividual(Shown->Individuals[DocPtr->m_CurrentIndividual]);
+		}
 	}
 	catch(CString Msg){
 		
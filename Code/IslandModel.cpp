@@ -0,0 +1,289 @@
+#include "StdAfx.h"
+#include "DNAStatement.h"
+#include ".\islandmodel.h"
+
+
+CIslandSettings::CIslandSettings():
+IslandCount(DEFAULTISLANDCOUNT), Topology(TOPOLOGY_RING),
+MigrationRate(DEFAULTMIGRATIONRATE), MigrationInterval(DEFAULTMIGRATIONINTERVAL),
+Processes(false){
+}
+
+vector<COUNTER> CIslandSettings::getNeighbours(COUNTER i, COUNTER Generation, unsigned __int64 RunSeed) const{
+
+	COUNTER N = getCount();
+	vector<COUNTER> Next;
+	if(N < 2) return Next;
+
+	switch(Topology){
+		case TOPOLOGY_TORUS:{
+			//Most square grid
+			COUNTER Rows = 1;
+			for(COUNTER r=1; r*r<=N; r++)
+				if(!(N % r)) Rows = r;
+			COUNTER Cols = N/Rows;
+
+			COUNTER r = i / Cols, c = i % Cols;
+			COUNTER East = r*Cols + (c+1)%Cols;
+			COUNTER South = ((r+1)%Rows)*Cols + c;
+			if(East != i) Next.push_back(East);
+			if((South != i) && (South != East)) Next.push_back(South);
+			break;
+		}
+
+		case TOPOLOGY_RANDOM:{
+			CRandom R(RunSeed, STREAM_MIGRATION, Generation, i);
+			COUNTER j = R.below(N - 1);
+			Next.push_back((j >= i) ? j + 1 : j);
+			break;
+		}
+
+		default:
+			Next.push_back((i+1)%N);
+	}
+	return Next;
+}
+
+COUNTER CIslandSettings::getMigrantCount(COUNTER PopulationSize) const{
+	return (COUNTER)(MigrationRate*PopulationSize + 0.5f);
+}
+
+
+/*******************************
+Mailbox Methods
+*******************************/
+CMailbox::CMailbox():
+Head(NULL){
+}
+
+CMailbox::~CMailbox(){
+	vector<CDNAStatement*> Left;
+	collect(Left);
+	for(COUNTER i=0; i<Left.size(); i++)
+		delete Left[i];
+}
+
+void CMailbox::post(CDNAStatement* S){
+	CMigrant* M = new CMigrant();
+	M->Individual = S;
+
+	CMigrant* Old;
+	do{
+		Old = Head;
+		M->Next = Old;
+	}while(InterlockedCompareExchangePointer((PVOID volatile*)&Head, M, Old) != Old);
+}
+
+void CMailbox::collect(vector<CDNAStatement*>& Arrived){
+	CMigrant* List = (CMigrant*)InterlockedExchangePointer((PVOID volatile*)&Head, NULL);
+
+	//The stack holds the newest post first
+	COUNTER First = (COUNTER)Arrived.size();
+	while(List){
+		CMigrant* Next = List->Next;
+		Arrived.push_back(List->Individual);
+		delete List;
+		List = Next;
+	}
+	reverse(Arrived.begin() + First, Arrived.end());
+}
+
+
+/*******************************
+Admin Methods
+*******************************/
+CIslandModel::CIslandModel(const CRunSettings& R, const CIslandSettings& S):
+Run(R), Settings(S), TargetGeneration(0), Active(0),
+Finished(FALSE, FALSE), HasError(false){
+
+	COUNTER N = Settings.getCount();
+
+	try{
+		for(COUNTER i=0; i<N; i++){
+			CIsland* I = new CIsland();
+			I->Model = this;
+			I->Index = i;
+			I->Population = NULL;
+			I->Thread = NULL;
+			I->Generation = 0;
+			I->BestFitness = INFINITY_GRADE;
+			Islands.push_back(I);
+
+			//Islands evolve on their own threads, so each runs its batches inline
+			I->Population = new CPopulation(Run, NULL, NULL, i);
+		}
+	}
+	catch(CString Mssg){
+		for(COUNTER i=0; i<Islands.size(); i++){
+			if(Islands[i]->Population) delete Islands[i]->Population;
+			delete Islands[i];
+		}
+		Islands.clear();
+		throw Mssg;
+	}
+}
+
+CIslandModel::~CIslandModel(){
+	stop();
+	joinThreads();
+	for(COUNTER i=0; i<Islands.size(); i++){
+		if(Islands[i]->Population) delete Islands[i]->Population;
+		delete Islands[i];
+	}
+	Islands.clear();
+}
+
+void CIslandModel::joinThreads(){
+	for(COUNTER i=0; i<Islands.size(); i++)
+		if(Islands[i]->Thread){
+			WaitForSingleObject(Islands[i]->Thread->m_hThread, INFINITE);
+			delete Islands[i]->Thread;
+			Islands[i]->Thread = NULL;
+		}
+}
+
+
+/*******************************
+Run Methods
+*******************************/
+void CIslandModel::start(COUNTER Generations){
+
+	joinThreads();
+	for(COUNTER i=0; i<Islands.size(); i++)
+		if(!Islands[i]->Population) throw CString(_T("An island was released at CIslandModel::start\r\n"));
+
+	TargetGeneration = Generations;
+	HasError = false;
+	InterlockedExchange(&Active, (LONG)Islands.size());
+
+	for(COUNTER i=0; i<Islands.size(); i++){
+		Islands[i]->Population->setRunning(true);
+		Islands[i]->Thread = AfxBeginThread(IslandProc, Islands[i], THREAD_PRIORITY_BELOW_NORMAL, 0, CREATE_SUSPENDED);
+		if(!Islands[i]->Thread){
+			stop();
+			for(COUNTER j=i; j<Islands.size(); j++)
+				InterlockedDecrement(&Active);
+			throw CString(_T("Could not start an island thread at CIslandModel::start\r\n"));
+		}
+		Islands[i]->Thread->m_bAutoDelete = FALSE;
+		Islands[i]->Thread->ResumeThread();
+	}
+}
+
+void CIslandModel::stop(){
+	for(COUNTER i=0; i<Islands.size(); i++)
+		if(Islands[i]->Population) Islands[i]->Population->setRunning(false);
+}
+
+bool CIslandModel::waitFor(DWORD Milliseconds){
+	//Throws the first error raised on an island, once all have stopped
+	if(Active) WaitForSingleObject(Finished.m_hObject, Milliseconds);
+	if(Active) return false;
+
+	joinThreads();
+	if(HasError){
+		HasError = false;
+		throw Error;
+	}
+	return true;
+}
+
+UINT CIslandModel::IslandProc(LPVOID Param){
+	CIsland* I = (CIsland*)Param;
+	I->Model->runIsland(*I);
+	return 0;
+}
+
+void CIslandModel::runIsland(CIsland& I){
+
+	CPopulation* P = I.Population;
+	try{
+		vector<CDNAStatement*> Arrived;
+		while(P->isRunning() && (P->getGeneration() < TargetGeneration)){
+
+			//Immigrants replace the newest offspring and are graded here
+			I.Inbox.collect(Arrived);
+			P->replaceTail(Arrived);
+
+			P->step();
+			if(!P->isRunning()) break;		//stopped or out of budget, the step was cancelled
+			InterlockedExchange(&I.Generation, (LONG)P->getGeneration());
+			StatsLock.Lock();
+			I.BestFitness = P->getBestFitness();
+			StatsLock.Unlock();
+
+			if(P->isRunning() && Settings.MigrationInterval && !(P->getGeneration() % Settings.MigrationInterval))
+				emigrate(I);
+		}
+	}
+	catch(CString Mssg){
+		ErrorLock.Lock();
+		if(!HasError){
+			CString Where;
+			Where.Format("\r\n -->On island %d", I.Index);
+			Error = Mssg + Where;
+			HasError = true;
+		}
+		ErrorLock.Unlock();
+		stop();
+	}
+
+	if(!InterlockedDecrement(&Active)) Finished.SetEvent();
+}
+
+
+/*******************************
+Migration Methods
+*******************************/
+void CIslandModel::emigrate(CIsland& I){
+	//Copies of the best individuals go to every neighbour
+	CPopulation* P = I.Population;
+	COUNTER Count = Settings.getMigrantCount((COUNTER)P->Individuals.size());
+	if(!Count) return;
+
+	vector<COUNTER> Elite = P->getElite(Count);
+	vector<COUNTER> To = Settings.getNeighbours(I.Index, P->getGeneration(), Run.RunSeed);
+	for(COUNTER n=0; n<To.size(); n++)
+		for(COUNTER k=0; k<Elite.size(); k++)
+			Islands[To[n]]->Inbox.post(new CDNAStatement(*(P->Individuals[Elite[k]])));
+}
+
+
+/*******************************
+Results
+*******************************/
+COUNTER CIslandModel::getGeneration() const{
+	COUNTER Slowest = 0;
+	for(COUNTER i=0; i<Islands.size(); i++)
+		if(!i || ((COUNTER)Islands[i]->Generation < Slowest))
+			Slowest = (COUNTER)Islands[i]->Generation;
+	return Slowest;
+}
+
+CPopulation* CIslandModel::releaseBestIsland(){
+	ASSERT(!Active);
+	if(Islands.empty() || !Islands[0]->Population) return NULL;
+
+	COUNTER Best = 0;
+	for(COUNTER i=1; i<Islands.size(); i++)
+		if(Islands[i]->Population && (Islands[i]->BestFitness < Islands[Best]->BestFitness))
+			Best = i;
+
+	CPopulation* P = Islands[Best]->Population;
+	Islands[Best]->Population = NULL;
+	return P;
+}
+
+CString CIslandModel::getStatistics() const{
+	CString Stats;
+	Stats.Format("%d islands at generation %d, best standardized fitness per island:",
+		Islands.size(), getGeneration());
+	StatsLock.Lock();
+	for(COUNTER i=0; i<Islands.size(); i++){
+		CString Island;
+		Island.Format(" %.3f", Islands[i]->BestFitness);
+		Stats += Island;
+	}
+	StatsLock.Unlock();
+	return Stats;
+}
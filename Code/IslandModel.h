@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Population.h"
+
+#define DEFAULTISLANDCOUNT 0
+//Island mode is off unless more than one island is set
+
+#define DEFAULTMIGRATIONRATE (double) 0.05f
+//Share of an island's population sent to each neighbour per migration
+
+#define DEFAULTMIGRATIONINTERVAL 5
+//Generations between two migrations
+
+enum ISLANDTOPOLOGY{
+	TOPOLOGY_RING = 0,		//island i sends to i+1
+	TOPOLOGY_TORUS,			//islands on a wrapped grid send east and south
+	TOPOLOGY_RANDOM,		//a random other island at every migration
+};
+
+struct CIslandSettings{
+	COUNTER IslandCount;
+	ISLANDTOPOLOGY Topology;
+	double MigrationRate;
+	COUNTER MigrationInterval;
+	bool Processes;					//each island in its own process, see SharedIslands.h
+
+	CIslandSettings();
+	COUNTER getCount() const { return IslandCount ? IslandCount : 1; };
+	vector<COUNTER> getNeighbours(COUNTER i, COUNTER Generation, unsigned __int64 RunSeed) const;
+	COUNTER getMigrantCount(COUNTER PopulationSize) const;
+};
+
+
+/*******************************
+Lock-free mailbox: any island may
+post, only its owner collects. Posts
+push onto a linked stack with a
+compare-and-swap; the owner takes the
+whole stack at once, so no ABA.
+*******************************/
+class CMailbox
+{
+	struct CMigrant{
+		CDNAStatement* Individual;
+		CMigrant* Next;
+	};
+	CMigrant* volatile Head;
+
+public:
+	CMailbox();
+	~CMailbox();
+
+	void post(CDNAStatement* S);						//takes ownership
+	void collect(vector<CDNAStatement*>& Arrived);		//oldest first
+};
+
+
+/*******************************
+What a UI needs to follow an island run,
+whatever the islands run on.
+*******************************/
+class CIslandRun
+{
+public:
+	virtual ~CIslandRun(){};
+
+	virtual void start(COUNTER Generations) = 0;		//evolve every island up to this generation
+	virtual bool waitFor(DWORD Milliseconds) = 0;		//true once all islands stopped
+	virtual void stop() = 0;
+
+	virtual COUNTER getGeneration() const = 0;			//of the slowest island
+	virtual CString getStatistics() const = 0;
+};
+
+
+/*******************************
+Island model: independent populations,
+each evolved by its own thread with the
+run settings, swapping copies of their
+best individuals every few generations.
+*******************************/
+class CIslandModel : public CIslandRun
+{
+	struct CIsland{
+		CIslandModel* Model;
+		COUNTER Index;
+		CPopulation* Population;
+		CMailbox Inbox;
+		CWinThread* Thread;
+		volatile LONG Generation;
+		double BestFitness;				//under StatsLock, the population is the thread's own
+	};
+
+	CRunSettings Run;
+	CIslandSettings Settings;
+	vector<CIsland*> Islands;
+	COUNTER TargetGeneration;
+
+	volatile LONG Active;				//islands still evolving
+	CEvent Finished;
+	mutable CCriticalSection StatsLock;
+	CCriticalSection ErrorLock;
+	CString Error;
+	bool HasError;
+
+	static UINT IslandProc(LPVOID Param);
+	void runIsland(CIsland& I);
+	void emigrate(CIsland& I);
+	void joinThreads();
+
+public:
+	CIslandModel(const CRunSettings& R, const CIslandSettings& S);
+	~CIslandModel();
+
+	void start(COUNTER Generations);
+	bool waitFor(DWORD Milliseconds);			//throws the first island error
+	void stop();
+
+	COUNTER getIslandCount() const { return (COUNTER)Islands.size(); };
+	COUNTER getGeneration() const;
+	CPopulation* releaseBestIsland();			//once stopped; the caller owns it
+	CString getStatistics() const;
+};
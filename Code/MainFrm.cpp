@@ -5,6 +5,7 @@
 #include "SymbolRegress.h"
 
 #include "MainFrm.h"
+#include "SymbolRegressDoc.h"
 #include ".\mainfrm.h"
 
 #ifdef _DEBUG
@@ -18,6 +19,7 @@ IMPLEMENT_DYNAMIC(CMainFrame, CMDIFrameWnd)
 
 BEGIN_MESSAGE_MAP(CMainFrame, CMDIFrameWnd)
 	ON_WM_CREATE()
+	ON_WM_TIMER()
 END_MESSAGE_MAP()
 
 static UINT indicators[] =
@@ -86,6 +88,9 @@ int CMainFrame::OnCreate(LPCREATESTRUCT lpCreateStruct)
 	EnableDocking(CBRS_ALIGN_ANY);
 	DockControlBar(&m_wndToolBar);
 
+	//Engines run on their own threads; the views follow them from here
+	SetTimer(SNAPSHOTTIMER, SNAPSHOTINTERVAL, NULL);
+
 	return 0;
 }
 
@@ -123,6 +128,26 @@ BOOL CMainFrame::OnCreateClient(LPCREATESTRUCT lpcs, CCreateContext* pContext)
 	return CMDIFrameWnd::OnCreateClient(lpcs, pContext);
 }
 
+void CMainFrame::OnTimer(UINT nIDEvent)
+{
+	if(nIDEvent != SNAPSHOTTIMER){
+		CMDIFrameWnd::OnTimer(nIDEvent);
+		return;
+	}
+
+	CWinApp* App = AfxGetApp();
+	POSITION TemplatePos = App->GetFirstDocTemplatePosition();
+	while(TemplatePos){
+		CDocTemplate* Template = App->GetNextDocTemplate(TemplatePos);
+		POSITION DocPos = Template->GetFirstDocPosition();
+		while(DocPos){
+			CDocument* Doc = Template->GetNextDoc(DocPos);
+			if(Doc->IsKindOf(RUNTIME_CLASS(CSymbolRegressDoc)))
+				((CSymbolRegressDoc*)Doc)->refreshFromEngine();
+		}
+	}
+}
+
 
 
 
@@ -3,6 +3,10 @@
 
 
 #pragma once
+
+#define SNAPSHOTTIMER 1
+//Timer that lets every document look at its engine's latest snapshot
+
 class CMainFrame : public CMDIFrameWnd
 {
 	DECLARE_DYNAMIC(CMainFrame)
@@ -40,6 +44,7 @@ protected:  // control bar embedded members
 // Generated message map functions
 protected:
 	afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
+	afx_msg void OnTimer(UINT nIDEvent);
 	DECLARE_MESSAGE_MAP()
 public:
 	
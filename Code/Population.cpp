@@ -0,0 +1,1047 @@
+#include "StdAfx.h"
+#include "DNAStatement.h"
+#include "EvaluatingFunction.h"
+#include "EquivalenceClasses.h"
+#include "RacingEvaluator.h"
+#include "ThreadPool.h"
+#include "BoundedQueue.h"
+#include "CaseTable.h"
+#include "CaseStream.h"
+#include ".\population.h"
+
+
+CRunSettings::CRunSettings():
+PopulationSize(300), SelectionSize(60), TournamentSize(DEFAULTTOURNAMENTSIZE),
+MaxDepth(10), CrossMaxDepth(5), TreeDensity(50), MutProb(0.2f),
+CaseCount(60), RangeMin(-1.0f), RangeMax(1.0f), RunSeed((COUNTER)time(NULL)),
+SteadyState(false), Pipelined(false), TimeBudget(0.0f), NodeBudget(0.0f), CaseBudget(0.0f),
+VariableCount(1), YColumn(1), StreamBudget(0), WorkerCount(0){
+	DataFile[0] = 0;
+	for(COUNTER v=0; v<MAXVARIABLES; v++)
+		XColumns[v] = 0;
+}
+
+
+/*******************************
+Admin Methods
+*******************************/
+CPopulation::CPopulation(const CRunSettings& S, CThreadPool* P, CRunObserver* Obs, COUNTER Island):
+Settings(S), Running(false), Pool(P), Observer(Obs), Cases(NULL), Generation(0), EquivalenceGroups(0),
+RacingCasesSaved(0.0f), Evaluations(0.0f), RunTicks(0), BatchTicks(0), MemoLookups(0), MemoFound(0),
+AllGraded(false), BestSoFar(NULL), BestIndex(0), EvalFunc(NULL){
+
+	//Island 0 keeps the run seed itself, so a single population replays as before
+	Seed = Island ? CRandom(Settings.RunSeed, STREAM_ISLAND, 0, Island).next() : Settings.RunSeed;
+
+	//The built-in target is a function of X_1 alone
+	if(!Settings.DataFile[0]) Settings.VariableCount = 1;
+	if((Settings.VariableCount < 1) || (Settings.VariableCount > MAXVARIABLES))
+		throw CString(_T("Invalid number of input columns at CPopulation construction\r\n"));
+
+	//Streamed cases are read once per generation, for the whole population
+	if(!Settings.DataFile[0]) Settings.StreamBudget = 0;
+	if(Settings.StreamBudget && (Settings.SteadyState || Settings.Pipelined || (Settings.TournamentSize > 1)))
+		throw CString(_T("Streamed fitness cases need generational roulette selection at CPopulation construction\r\n"));
+
+	try{
+		for(COUNTER i=0; i<Settings.PopulationSize; i++){
+			CRandom R(Seed, STREAM_GROW, 0, i);
+			CRandomScope Scope(R);
+			Individuals.push_back(new CDNAStatement(UNDEF, Settings.TreeDensity));
+			Individuals[i]->growCreate(Settings.MaxDepth, Settings.VariableCount);
+		}
+
+		EvalFunc = new CEvaluatingFunction(Settings.RangeMin, Settings.RangeMax);
+		EvalFunc->setCancel(&Running);
+		if(Settings.DataFile[0]){
+			Cases = CCaseTable::open(Settings.DataFile, Settings.XColumns, Settings.VariableCount,
+				Settings.YColumn, Settings.StreamBudget > 0);
+			EvalFunc->setTable(Cases);
+		}
+		generateCases(Generation);
+	}
+	catch(CString Mssg){
+		for(COUNTER i=0; i<Individuals.size(); i++)
+			delete Individuals[i];
+		if(EvalFunc) delete EvalFunc;
+		CCaseTable::release(Cases);
+		throw Mssg;
+	}
+}
+
+CPopulation::~CPopulation(){
+	for(COUNTER i=0; i<Individuals.size(); i++)
+		if(Individuals[i])
+			delete Individuals[i];
+	Individuals.clear();
+	if(EvalFunc) delete EvalFunc;
+	CCaseTable::release(Cases);
+	if(BestSoFar) delete BestSoFar;
+}
+
+
+/*******************************
+Batch Methods
+*******************************/
+static COUNTER TaskBound(COUNTER t, COUNTER TaskCount, COUNTER Size){
+	//Start of task t when Size items are cut into TaskCount even runs
+	return (COUNTER)(((unsigned __int64)t*Size)/TaskCount);
+}
+
+static COUNTER CostBound(const vector<double>& Prefix, COUNTER t, COUNTER TaskCount){
+	//Start of task t when items of the given cumulative costs are cut into
+	//TaskCount runs of even cost
+	double Target = (Prefix.back()*t)/TaskCount;
+	return (COUNTER)(lower_bound(Prefix.begin(), Prefix.end(), Target) - Prefix.begin());
+}
+
+COUNTER CPopulation::getTaskCount(COUNTER Size) const{
+	COUNTER TaskCount = Pool ? Pool->getWorkerCount()*TASKSPERWORKER : 1;
+	return (TaskCount > Size) ? Size : TaskCount;
+}
+
+void CPopulation::runTasks(vector<CPoolTask*>& Tasks, volatile LONG& Done, COUNTER Total){
+	//Runs the tasks on the pool, telling the observer how far they are
+	//while it waits. Tasks are deleted afterwards.
+	try{
+		if(!Pool){
+			for(COUNTER t=0; t<Tasks.size(); t++)
+				Tasks[t]->run(0);
+		}
+		else{
+			//Task t works on the t-th run of the population in every batch, so on a
+			//NUMA pool each run stays with the same node from batch to batch
+			CTaskGroup Batch(*Pool);
+			COUNTER Nodes = Pool->getNodeCount();
+			vector<unsigned __int64> BusyBefore(Pool->getWorkerCount());
+			for(COUNTER w=0; w<BusyBefore.size(); w++)
+				BusyBefore[w] = Pool->getBusyTicks(w);
+			unsigned __int64 Start = CThreadPool::getTicks();
+			try{
+				for(COUNTER t=0; t<Tasks.size(); t++)
+					Batch.run(Tasks[t], (Nodes > 1) ? (int)((t*Nodes)/Tasks.size()) : -1);
+				while(!Batch.waitFor(PROGRESSINTERVAL))
+					if(Observer) Observer->waiting((COUNTER)Done, Total);
+				recordIdle(BusyBefore, Start);
+			}
+			catch(CString Mssg){
+				//Tasks still running refer to the population: let them drain first
+				Running = false;
+				try{ Batch.wait(); }catch(CString){}
+				throw Mssg;
+			}
+		}
+	}
+	catch(CString Mssg){
+		for(COUNTER t=0; t<Tasks.size(); t++)
+			delete Tasks[t];
+		Tasks.clear();
+		throw Mssg;
+	}
+	for(COUNTER t=0; t<Tasks.size(); t++)
+		delete Tasks[t];
+	Tasks.clear();
+}
+
+
+void CPopulation::recordIdle(const vector<unsigned __int64>& BusyBefore, unsigned __int64 Start){
+	//A worker was idle for whatever part of the batch it spent outside tasks
+	unsigned __int64 Wall = CThreadPool::getTicks() - Start;
+	BatchTicks += Wall;
+	if(WorkerIdleTicks.size() != BusyBefore.size()) WorkerIdleTicks.assign(BusyBefore.size(), 0);
+	for(COUNTER w=0; w<BusyBefore.size(); w++){
+		unsigned __int64 Busy = Pool->getBusyTicks(w) - BusyBefore[w];
+		if(Busy < Wall) WorkerIdleTicks[w] += Wall - Busy;
+	}
+}
+
+
+/*******************************
+Evaluation Methods
+*******************************/
+
+/*******************************
+Grading task: scores a run of
+representatives on a pool worker.
+*******************************/
+class CGradeTask : public CPoolTask
+{
+	CEvaluatingFunction* EvalFunc;
+	const vector<CDNAStatement*>& Population;
+	const vector<COUNTER>& Indices;
+	const CEquivalenceClasses& Groups;
+	COUNTER Beg, End;
+	volatile bool& Running;
+	volatile LONG& Graded;
+
+public:
+	CGradeTask(CEvaluatingFunction* Eval, const vector<CDNAStatement*>& Pop, const vector<COUNTER>& Ind,
+		const CEquivalenceClasses& Grp, COUNTER b, COUNTER e, volatile bool& R, volatile LONG& G):
+	EvalFunc(Eval), Population(Pop), Indices(Ind), Groups(Grp), Beg(b), End(e), Running(R), Graded(G){};
+
+	void run(COUNTER Worker){
+		for(COUNTER k=Beg; (k<End)&&(Running); k++){
+			EvalFunc->EvaluateCDNA(Population[Indices[k]], NULL, &Groups.getForm(Indices[k]));
+			InterlockedIncrement(&Graded);
+		}
+	}
+};
+
+/*******************************
+Stream task: runs a run of compiled
+representatives over one buffer of
+streamed cases.
+*******************************/
+struct CStreamEntry{
+	CDNAStatement* Individual;
+	CCompiledStatement* Compiled;
+	CCaseErrors Errors;
+	bool Undefined;
+};
+
+class CStreamTask : public CPoolTask
+{
+	CEvaluatingFunction* EvalFunc;
+	vector<CStreamEntry>& Entries;
+	const CCaseBuffer& Buffer;
+	COUNTER Beg, End;
+	volatile bool& Running;
+	volatile LONG& Scored;
+
+public:
+	CStreamTask(CEvaluatingFunction* Eval, vector<CStreamEntry>& E, const CCaseBuffer& B,
+		COUNTER b, COUNTER e, volatile bool& R, volatile LONG& S):
+	EvalFunc(Eval), Entries(E), Buffer(B), Beg(b), End(e), Running(R), Scored(S){};
+
+	void run(COUNTER Worker){
+		for(COUNTER k=Beg; (k<End)&&(Running); k++){
+			CStreamEntry& E = Entries[k];
+			if(!E.Undefined){
+				try{
+					EvalFunc->EvaluateCases(*E.Compiled, Buffer.X, Buffer.Y, Buffer.Rows, E.Errors);
+				}
+				catch(CString Mssg){
+					if(Mssg == CString(_T("UNDEF"))) E.Undefined = true;
+					else if(Mssg != CString(_T("CANCELLED"))) throw Mssg;
+				}
+			}
+			InterlockedIncrement(&Scored);
+		}
+	}
+};
+
+void CPopulation::generateCases(COUNTER CaseGeneration){
+	CRandom Cases(Seed, STREAM_CASES, CaseGeneration, 0);
+	CRandomScope Scope(Cases);
+	EvalFunc->generatePoints(Settings.CaseCount);
+	EvalFunc->resetCounters();
+	AllGraded = false;
+}
+
+void CPopulation::findBest(){
+	BestIndex = 0;
+	for(COUNTER i=0; i<Individuals.size();i++){
+		if(!Individuals[i]) continue;
+		if(Individuals[i]->Fitness->getNormalizedFitness() > Individuals[BestIndex]->Fitness->getNormalizedFitness())
+			BestIndex = i;
+	}
+}
+
+void CPopulation::keepBest(){
+	//Copied after every population graded in full: a cancelled step
+	//leaves ungraded children behind, a stopped run reports this one
+	if((BestIndex >= Individuals.size()) || !Individuals[BestIndex]) return;
+	CDNAStatement* Best = new CDNAStatement(*(Individuals[BestIndex]));
+	if(BestSoFar) delete BestSoFar;
+	BestSoFar = Best;
+}
+
+void CPopulation::evaluate(bool NewCases){
+
+	BestIndex = 0;
+
+	try{
+		if(NewCases) generateCases(Generation);
+
+		//Mathematically identical individuals share a single evaluation
+		CEquivalenceClasses Groups;
+		if(!Groups.build(Individuals, EvalFunc)){		//the run was stopped meanwhile
+			AllGraded = false;
+			return;
+		}
+		EquivalenceGroups = Groups.getGroupCount();
+
+		vector<COUNTER> Representatives;
+		for(COUNTER i=0; i<Individuals.size(); i++)
+			if(Individuals[i] && Groups.isRepresentative(i))		//raceSelect leaves the tail empty
+				Representatives.push_back(i);
+
+		volatile LONG Graded = 0;
+		if(Cases && Cases->isStreamed())
+			Graded = evaluateStreamed(Representatives, Groups);
+		else if(Pool && (Representatives.size() < Pool->getWorkerCount()) && (EvalFunc->getCaseCount() >= SPLITCASECOUNT)){
+			//Too few representatives to keep the pool busy: each one is split over the cases
+			for(COUNTER k=0; (k<Representatives.size())&&(Running); k++){
+				EvalFunc->EvaluateCDNA(Individuals[Representatives[k]], Pool, &Groups.getForm(Representatives[k]));
+				Graded++;
+			}
+		}
+		else{
+			//Representatives are graded on the pool in runs of even estimated cost,
+			//tree size times case count, so no task is left with the large trees
+			vector<double> Prefix(1, 0.0f);
+			for(COUNTER k=0; k<Representatives.size(); k++)
+				Prefix.push_back(Prefix.back() +
+					(double)Individuals[Representatives[k]]->getSize()*EvalFunc->getCaseCount());
+
+			COUNTER TaskCount = getTaskCount((COUNTER)Representatives.size());
+			vector<CPoolTask*> Tasks;
+			for(COUNTER t=0; t<TaskCount; t++)
+				Tasks.push_back(new CGradeTask(EvalFunc, Individuals, Representatives, Groups,
+					CostBound(Prefix, t, TaskCount), CostBound(Prefix, t+1, TaskCount), Running, Graded));
+			runTasks(Tasks, Graded, (COUNTER)Representatives.size());
+		}
+		Evaluations += (double)Graded;
+
+		for(COUNTER i=0; i<Individuals.size(); i++)
+			if(Individuals[i] && !Groups.isRepresentative(i))
+				*(Individuals[i]->Fitness) = *(Individuals[Groups.getRepresentative(i)]->Fitness);
+
+		//Totals are reduced over the graded population, which is normalized against them
+		Summary.normalize(Individuals);
+		findBest();
+		AllGraded = Running;
+		if(AllGraded) keepBest();
+
+	}
+	catch(CString Mssg){
+		Running = false;
+		throw Mssg;
+	}
+}
+
+
+COUNTER CPopulation::evaluateStreamed(const vector<COUNTER>& Representatives, const CEquivalenceClasses& Groups){
+
+	//Representatives not in the memo are compiled once, then run buffer by buffer
+	//over the whole file, in its order; the reader fills the next buffers while
+	//the pool scores this one. Returns the representatives graded
+	COUNTER Graded = 0;
+	vector<CStreamEntry> Entries;
+	try{
+		for(COUNTER k=0; k<Representatives.size(); k++){
+			CDNAStatement* Individual = Individuals[Representatives[k]];
+			if(EvalFunc->recallGrade(Individual)){
+				Graded++;
+				continue;
+			}
+			CStreamEntry E;
+			E.Individual = Individual;
+			E.Compiled = NULL;
+			E.Undefined = false;
+			Entries.push_back(E);
+			Entries.back().Compiled = new CCompiledStatement();
+			try{
+				Entries.back().Compiled->compile(*Individual, &Groups.getForm(Representatives[k]));
+			}
+			catch(CString Mssg){
+				if(Mssg != CString(_T("UNDEF"))) throw Mssg;
+				Entries.back().Undefined = true;
+			}
+		}
+
+		if(Entries.size()){
+			//Runs of even cost per case, as in evaluate
+			vector<double> Prefix(1, 0.0f);
+			for(COUNTER k=0; k<Entries.size(); k++)
+				Prefix.push_back(Prefix.back() + (Entries[k].Undefined ? 0.0f : (double)Entries[k].Compiled->CaseCost) + 1.0f);
+			COUNTER TaskCount = getTaskCount((COUNTER)Entries.size());
+
+			CCaseStream Stream(*Cases, (unsigned __int64)Settings.StreamBudget*1024*1024);
+			const CCaseBuffer* Buffer;
+			while(Running && (Buffer = Stream.next())){
+				volatile LONG Scored = 0;
+				vector<CPoolTask*> Tasks;
+				for(COUNTER t=0; t<TaskCount; t++)
+					Tasks.push_back(new CStreamTask(EvalFunc, Entries, *Buffer,
+						CostBound(Prefix, t, TaskCount), CostBound(Prefix, t+1, TaskCount), Running, Scored));
+				runTasks(Tasks, Scored, (COUNTER)Entries.size());
+				Stream.release();
+			}
+		}
+
+		//A stopped run leaves its representatives ungraded, like a cancelled one
+		for(COUNTER k=0; k<Entries.size(); k++){
+			if(Running){
+				EvalFunc->setGrade(Entries[k].Individual, Entries[k].Errors, Entries[k].Undefined,
+					(double)Cases->getStreamRows());
+				Graded++;
+			}
+			else{
+				Entries[k].Individual->Fitness->reset();
+				Entries[k].Individual->Fitness->setStandardizedFitness(INFINITY_GRADE);
+			}
+		}
+	}
+	catch(CString Mssg){
+		for(COUNTER k=0; k<Entries.size(); k++)
+			if(Entries[k].Compiled) delete Entries[k].Compiled;
+		throw Mssg;
+	}
+	for(COUNTER k=0; k<Entries.size(); k++)
+		delete Entries[k].Compiled;
+	return Graded;
+}
+
+
+/*******************************
+Selection Methods
+*******************************/
+void CPopulation::replaceBySurvivors(vector<CDNAStatement*>& Survivors){
+
+	//Clear out Population
+	for(COUNTER i=0; i<Individuals.size();i++){
+		if(Individuals[i]) {
+			delete Individuals[i];
+			Individuals[i] = NULL;
+		}
+	}
+
+	for(COUNTER i=0; i<Survivors.size(); i++)
+		Individuals[i] = Survivors[i];
+}
+
+void CPopulation::select(){
+
+	if(Settings.SelectionSize > Settings.PopulationSize)
+		throw CString(_T("The SelectionSize Facteur must be less than the size of the Population"));
+
+	vector<CDNAStatement*> NewPopulation;
+
+	int TotFit = (int)Summary.TotalNormalizedFitness;
+	if(TotFit < 1) TotFit=1;
+	int ind = 0;
+	double acc;
+	CRandom R(Seed, STREAM_SELECT, Generation, 0);
+
+
+	//Keep the best one
+	NewPopulation.push_back(new CDNAStatement(*(Individuals[BestIndex])));
+
+	while(NewPopulation.size() < Settings.SelectionSize){
+		acc = (double)(R.below(TotFit) + 1);
+		while ((acc - Individuals[ind]->Fitness->getNormalizedFitness()) > 0.0){
+			acc -= Individuals[ind]->Fitness->getNormalizedFitness();
+			ind = (ind+1)%Individuals.size();
+		}
+		NewPopulation.push_back(new CDNAStatement(*(Individuals[ind])));
+
+	}
+
+	replaceBySurvivors(NewPopulation);
+	BestIndex = 0;
+
+	//breed draws parents from the survivors only
+	Summary.reduce(Individuals);
+}
+
+/*******************************
+Finishing task: runs a run of race
+winners over the cases they were not
+raced on.
+*******************************/
+class CFinishTask : public CPoolTask
+{
+	CRacingEvaluator& Racer;
+	const vector<COUNTER>& Winners;
+	COUNTER Beg, End;
+	volatile bool& Running;
+	volatile LONG& Finished;
+
+public:
+	CFinishTask(CRacingEvaluator& Rc, const vector<COUNTER>& W, COUNTER b, COUNTER e,
+		volatile bool& R, volatile LONG& F):
+	Racer(Rc), Winners(W), Beg(b), End(e), Running(R), Finished(F){};
+
+	void run(COUNTER Worker){
+		for(COUNTER k=Beg; (k<End)&&(Running); k++){
+			Racer.finish(Winners[k]);
+			InterlockedIncrement(&Finished);
+		}
+	}
+};
+
+void CPopulation::raceSelect(){
+
+	if(Settings.SelectionSize > Settings.PopulationSize)
+		throw CString(_T("The SelectionSize Facteur must be less than the size of the Population"));
+
+	vector<CDNAStatement*> NewPopulation;
+
+	try{
+		generateCases(Generation);
+
+		//Keep the best one: the winner of a race over the whole population on
+		//these cases, as the children bred since the last grading have none
+		CRacingEvaluator Racer(EvalFunc, Individuals);
+		vector<COUNTER> Everyone;
+		for(COUNTER i=0; i<Individuals.size(); i++)
+			if(Individuals[i]) Everyone.push_back(i);
+		vector<COUNTER> Won(1, Racer.race(Everyone));		//population index of every survivor
+		NewPopulation.push_back(new CDNAStatement(*(Individuals[Won[0]])));
+
+		//Every other survivor wins a race among TournamentSize random individuals
+		vector<COUNTER> Candidates(Settings.TournamentSize);
+		CRandom R(Seed, STREAM_SELECT, Generation, 0);
+		while((NewPopulation.size() < Settings.SelectionSize)&&(Running)){
+			if(Observer) Observer->waiting((COUNTER)NewPopulation.size(), Settings.SelectionSize);
+			for(COUNTER k=0; k<Settings.TournamentSize; k++)
+				Candidates[k] = R.below((COUNTER)Individuals.size());
+			Won.push_back(Racer.race(Candidates));
+			NewPopulation.push_back(new CDNAStatement(*(Individuals[Won.back()])));
+		}
+
+		//Survivors are scored in full for the roulette in breed: each winner
+		//once, on the cases it was not raced on
+		vector<COUNTER> Winners(Won);
+		sort(Winners.begin(), Winners.end());
+		Winners.erase(unique(Winners.begin(), Winners.end()), Winners.end());
+		volatile LONG Finished = 0;
+		COUNTER TaskCount = getTaskCount((COUNTER)Winners.size());
+		vector<CPoolTask*> Tasks;
+		for(COUNTER t=0; t<TaskCount; t++)
+			Tasks.push_back(new CFinishTask(Racer, Winners,
+				TaskBound(t, TaskCount, (COUNTER)Winners.size()),
+				TaskBound(t+1, TaskCount, (COUNTER)Winners.size()), Running, Finished));
+		runTasks(Tasks, Finished, (COUNTER)Winners.size());
+		Evaluations += (double)Finished;
+
+		if(Running){
+			for(COUNTER k=0; k<NewPopulation.size(); k++)
+				Racer.grade(Won[k], NewPopulation[k]);
+			EquivalenceGroups = (COUNTER)Winners.size();
+			RacingCasesSaved = (double)Racer.getCasesSaved();
+		}
+	}
+	catch(CString Mssg){
+		Running = false;
+		for(COUNTER i=0; i<NewPopulation.size(); i++)
+			delete NewPopulation[i];
+		throw Mssg;
+	}
+
+	//A stopped run keeps its whole population
+	if(!Running){
+		for(COUNTER i=0; i<NewPopulation.size(); i++)
+			delete NewPopulation[i];
+		return;
+	}
+
+	replaceBySurvivors(NewPopulation);
+	Summary.normalize(Individuals);
+	findBest();
+	AllGraded = true;
+	keepBest();
+}
+
+
+/*******************************
+Breeding Methods
+*******************************/
+
+static void breedSlot(vector<CDNAStatement*>& Population, const vector<double>& Weights, int TotFit,
+					  COUNTER Survivors, COUNTER Variables, unsigned __int64 Seed, COUNTER Generation, COUNTER Slot){
+	//Each slot draws from its own stream, so children do not depend on
+	//the thread count
+	CRandom R(Seed, STREAM_OFFSPRING, Generation, Slot);
+	CRandomScope Scope(R);
+
+	//Mom by the walk of the serial Breed: a random amount of the total
+	//normalized fitness is spent on random survivors until one outweighs
+	//what is left. The walk starts on a random survivor rather than where
+	//the previous child's ended. Pop in turn.
+	double acc = (double)(R.below(TotFit)+1);
+	COUNTER indMom = R.below(Survivors);
+	while((acc - Weights[indMom]) > 0.0f){
+		acc -= Weights[indMom];
+		indMom = R.below(Survivors);
+	}
+	COUNTER indPop = (Slot - Survivors)%Survivors;
+
+	Population[Slot] = &(Population[indPop]->cross(*(Population[indMom]), Variables));
+}
+
+/*******************************
+Breeding task: fills a run of
+offspring slots.
+*******************************/
+class CBreedTask : public CPoolTask
+{
+	vector<CDNAStatement*>& Population;
+	const vector<double>& Weights;
+	int TotFit;
+	COUNTER Survivors;
+	COUNTER Variables;
+	COUNTER Beg, End;
+	unsigned __int64 Seed;
+	COUNTER Generation;
+	volatile LONG& Bred;
+
+public:
+	CBreedTask(vector<CDNAStatement*>& Pop, const vector<double>& W, int Tot, COUNTER Surv, COUNTER Vars,
+		COUNTER b, COUNTER e, unsigned __int64 S, COUNTER Gen, volatile LONG& Br):
+	Population(Pop), Weights(W), TotFit(Tot), Survivors(Surv), Variables(Vars), Beg(b), End(e), Seed(S), Generation(Gen), Bred(Br){};
+
+	void run(COUNTER Worker){
+		for(COUNTER Slot=Beg; Slot<End; Slot++){
+			breedSlot(Population, Weights, TotFit, Survivors, Variables, Seed, Generation, Slot);
+			InterlockedIncrement(&Bred);
+		}
+	}
+};
+
+COUNTER CPopulation::prepareParents(vector<double>& Weights, int& TotFit){
+
+	COUNTER BegPopSize = 0;
+	for(COUNTER i=0; i<Individuals.size(); i++)
+		if(Individuals[i])
+			BegPopSize++;
+
+	//Parents are only read by the workers, so they are set up beforehand
+	for(COUNTER i=0; i<BegPopSize; i++){
+		Individuals[i]->setCrossOverMaxDepth(Settings.CrossMaxDepth);
+		Individuals[i]->setMutationProb(Settings.MutProb);
+		Weights.push_back(Individuals[i]->Fitness->getNormalizedFitness());
+	}
+	TotFit = (int)Summary.TotalNormalizedFitness;
+	if(TotFit < 1) TotFit = 1;
+	return BegPopSize;
+}
+
+void CPopulation::breed(){
+
+	vector<double> Weights;
+	int TotFit;
+	COUNTER BegPopSize = prepareParents(Weights, TotFit);
+	if(!BegPopSize) return;
+	AllGraded = false;
+
+	//Every child is written straight into its own slot of the population
+	COUNTER Children = (COUNTER)Individuals.size() - BegPopSize;
+	COUNTER TaskCount = getTaskCount(Children);
+	volatile LONG Bred = 0;
+	vector<CPoolTask*> Tasks;
+	for(COUNTER t=0; t<TaskCount; t++)
+		Tasks.push_back(new CBreedTask(Individuals, Weights, TotFit, BegPopSize, Settings.VariableCount,
+			BegPopSize + TaskBound(t, TaskCount, Children),
+			BegPopSize + TaskBound(t+1, TaskCount, Children), Seed, Generation, Bred));
+	runTasks(Tasks, Bred, Children);
+}
+
+
+/*******************************
+Pipelined Methods
+*******************************/
+
+/*******************************
+Pipeline task: breeds offspring into
+the bounded queue and grades whatever
+it finds there, so grading starts with
+the first child and breeding never runs
+far ahead of it. Tickets hand out the
+children first, then the survivors,
+which are only regraded once no child
+is still being bred from them.
+*******************************/
+class CPipelineTask : public CPoolTask
+{
+	vector<CDNAStatement*>& Population;
+	const vector<double>& Weights;
+	int TotFit;
+	COUNTER Survivors;
+	COUNTER Variables;
+	unsigned __int64 Seed;
+	COUNTER Generation;
+	CEvaluatingFunction* EvalFunc;
+	CBoundedQueue<COUNTER>& Queue;
+	volatile LONG& Tickets;
+	volatile LONG& Bred;
+	volatile LONG& Graded;
+	volatile bool& Running;
+
+	void grade(COUNTER Slot){
+		EvalFunc->EvaluateCDNA(Population[Slot]);
+		InterlockedIncrement(&Graded);
+	}
+
+public:
+	CPipelineTask(vector<CDNAStatement*>& Pop, const vector<double>& W, int Tot, COUNTER Surv, COUNTER Vars,
+		unsigned __int64 S, COUNTER Gen, CEvaluatingFunction* Eval, CBoundedQueue<COUNTER>& Q,
+		volatile LONG& T, volatile LONG& B, volatile LONG& G, volatile bool& Run):
+	Population(Pop), Weights(W), TotFit(Tot), Survivors(Surv), Variables(Vars), Seed(S), Generation(Gen), EvalFunc(Eval),
+	Queue(Q), Tickets(T), Bred(B), Graded(G), Running(Run){};
+
+	void run(COUNTER Worker){
+		COUNTER Size = (COUNTER)Population.size();
+		COUNTER Children = Size - Survivors;
+
+		for(;;){
+			COUNTER Slot;
+			if(Running && Queue.tryPop(Slot)){
+				grade(Slot);
+				continue;
+			}
+
+			//A stopped run still breeds every child, so no slot is left empty
+			LONG Ticket = Tickets;
+			if((COUNTER)Ticket >= (Running ? Size : Children)) return;
+			if(((COUNTER)Ticket >= Children) && ((COUNTER)Bred < Children)){
+				SwitchToThread();
+				continue;
+			}
+			if(InterlockedCompareExchange(&Tickets, Ticket + 1, Ticket) != Ticket) continue;
+
+			if((COUNTER)Ticket < Children){
+				Slot = Survivors + Ticket;
+				breedSlot(Population, Weights, TotFit, Survivors, Variables, Seed, Generation, Slot);
+				InterlockedIncrement(&Bred);
+
+				//A full queue means grading lags: grade this one here
+				if(Running && !Queue.tryPush(Slot)) grade(Slot);
+			}
+			else grade(Ticket - Children);
+		}
+	}
+};
+
+void CPopulation::pipelinedStep(){
+	//The first generation has nothing to overlap with
+	if(!AllGraded){
+		evaluate();
+		if(!Running) return;
+	}
+	select();
+
+	vector<double> Weights;
+	int TotFit;
+	COUNTER Survivors = prepareParents(Weights, TotFit);
+	if(!Survivors) return;
+
+	//Children and survivors are graded on the next generation's cases
+	//as they come, rather than in a batch after breeding
+	generateCases(Generation + 1);
+	COUNTER TaskCount = Pool ? Pool->getWorkerCount() : 1;
+	CBoundedQueue<COUNTER> Queue(TaskCount*PIPELINEDEPTH);
+	volatile LONG Tickets = 0;
+	volatile LONG Bred = 0;
+	volatile LONG Graded = 0;
+	vector<CPoolTask*> Tasks;
+	for(COUNTER t=0; t<TaskCount; t++)
+		Tasks.push_back(new CPipelineTask(Individuals, Weights, TotFit, Survivors, Settings.VariableCount, Seed, Generation,
+			EvalFunc, Queue, Tickets, Bred, Graded, Running));
+	runTasks(Tasks, Graded, (COUNTER)Individuals.size());
+	Evaluations += (double)Graded;
+	if(!Running) return;
+
+	Summary.normalize(Individuals);
+	findBest();
+	AllGraded = true;
+	keepBest();
+}
+
+
+/*******************************
+Steady-State Methods
+*******************************/
+static void lockSlot(LONG& Lock){
+	while(InterlockedCompareExchange(&Lock, 1, 0))
+		SwitchToThread();
+}
+
+static void unlockSlot(LONG& Lock){
+	InterlockedExchange(&Lock, 0);
+}
+
+/*******************************
+Steady-state task: takes tickets from
+the epoch's budget and for each breeds
+a child of two tournament winners,
+grades it and puts it in place of a
+tournament loser. There is no barrier
+between children: a slot is only ever
+locked while it is read or swapped.
+*******************************/
+class CSteadyTask : public CPoolTask
+{
+	vector<CDNAStatement*>& Population;
+	vector<LONG>& Locks;
+	CEvaluatingFunction* EvalFunc;
+	const CRunSettings& Settings;
+	unsigned __int64 Seed;
+	COUNTER Generation, Task;
+	volatile LONG& Tickets;
+	volatile bool& Running;
+	volatile LONG& Done;
+
+	double fitnessOf(COUNTER Slot){
+		lockSlot(Locks[Slot]);
+		double F = Population[Slot]->Fitness->getStandardizedFitness();
+		unlockSlot(Locks[Slot]);
+		return F;
+	}
+
+	COUNTER tournament(CRandom& R, COUNTER Size, bool Loser){
+		//Best, or worst, standardized fitness among Size random slots
+		COUNTER Winner = R.below((COUNTER)Population.size());
+		double WinnerFitness = fitnessOf(Winner);
+		for(COUNTER k=1; k<Size; k++){
+			COUNTER Slot = R.below((COUNTER)Population.size());
+			double F = fitnessOf(Slot);
+			if(Loser ? (F > WinnerFitness) : (F < WinnerFitness)){
+				Winner = Slot;
+				WinnerFitness = F;
+			}
+		}
+		return Winner;
+	}
+
+	CDNAStatement* copyOf(COUNTER Slot){
+		lockSlot(Locks[Slot]);
+		CDNAStatement* Copy = NULL;
+		try{
+			Copy = new CDNAStatement(*(Population[Slot]));
+		}
+		catch(CString Mssg){
+			unlockSlot(Locks[Slot]);
+			throw Mssg;
+		}
+		unlockSlot(Locks[Slot]);
+		Copy->setCrossOverMaxDepth(Settings.CrossMaxDepth);
+		Copy->setMutationProb(Settings.MutProb);
+		return Copy;
+	}
+
+public:
+	CSteadyTask(vector<CDNAStatement*>& Pop, vector<LONG>& L, CEvaluatingFunction* Eval,
+		const CRunSettings& S, unsigned __int64 Sd, COUNTER Gen, COUNTER T,
+		volatile LONG& Tk, volatile bool& R, volatile LONG& D):
+	Population(Pop), Locks(L), EvalFunc(Eval), Settings(S), Seed(Sd), Generation(Gen), Task(T),
+	Tickets(Tk), Running(R), Done(D){};
+
+	void run(COUNTER Worker){
+		CRandom R(Seed, STREAM_STEADY, Generation, Task);
+		CRandomScope Scope(R);
+		COUNTER Size = (Settings.TournamentSize > 1) ? Settings.TournamentSize : STEADYTOURNAMENTSIZE;
+
+		while(Running && ((COUNTER)InterlockedIncrement(&Tickets) <= Settings.PopulationSize)){
+			CDNAStatement* Mom = copyOf(tournament(R, Size, false));
+			CDNAStatement* Pop = NULL;
+			CDNAStatement* Kid = NULL;
+			try{
+				Pop = copyOf(tournament(R, Size, false));
+				Kid = &(Pop->cross(*Mom, Settings.VariableCount));
+				EvalFunc->EvaluateCDNA(Kid);
+			}
+			catch(CString Mssg){
+				delete Mom;
+				if(Pop) delete Pop;
+				if(Kid) delete Kid;
+				throw Mssg;
+			}
+			delete Mom;
+			delete Pop;
+			if(!Running){
+				//Graded as cancelled, so it would only displace a real grade
+				delete Kid;
+				break;
+			}
+
+			COUNTER Slot = tournament(R, Size, true);
+			lockSlot(Locks[Slot]);
+			CDNAStatement* Replaced = Population[Slot];
+			Population[Slot] = Kid;
+			unlockSlot(Locks[Slot]);
+			delete Replaced;
+
+			InterlockedIncrement(&Done);
+		}
+	}
+};
+
+void CPopulation::steadyStep(){
+	//Cases stay fixed for the whole run, so every grade stays comparable
+	if(!AllGraded){
+		evaluate(false);
+		if(!Running) return;
+	}
+
+	//One task per worker: tickets keep them all busy until the budget
+	//is spent, so only the last few children of an epoch run unevenly
+	SlotLocks.assign(Individuals.size(), 0);
+	COUNTER TaskCount = Pool ? Pool->getWorkerCount() : 1;
+	volatile LONG Tickets = 0;
+	volatile LONG Done = 0;
+	vector<CPoolTask*> Tasks;
+	for(COUNTER t=0; t<TaskCount; t++)
+		Tasks.push_back(new CSteadyTask(Individuals, SlotLocks, EvalFunc, Settings,
+			Seed, Generation, t, Tickets, Running, Done));
+	runTasks(Tasks, Done, Settings.PopulationSize);
+	Evaluations += (double)Done;
+
+	Summary.normalize(Individuals);
+	findBest();
+	if(Running) keepBest();
+}
+
+bool CPopulation::applyBudget(){
+	//Hands what is left of the budgets to the evaluation kernels, which check
+	//them at every block of cases; false once one is spent
+	double Left = Settings.TimeBudget*1000.0f - RunTicks;
+	if(Left < 0.0f) Left = 0.0f;
+	EvalFunc->setBudget(Settings.TimeBudget > 0.0f, (DWORD)Left, Settings.NodeBudget, Settings.CaseBudget);
+	return Running && !EvalFunc->isCancelled();
+}
+
+void CPopulation::step(){
+	DWORD Start = GetTickCount();
+	unsigned __int64 LookupsBefore, FoundBefore;
+	EvalFunc->getMemoCounts(LookupsBefore, FoundBefore);
+
+	if(!applyBudget())
+		return;
+	else if(Settings.SteadyState)
+		steadyStep();
+	else if(Settings.TournamentSize > 1){
+		raceSelect();
+		if(Running) breed();
+	}
+	else if(Settings.Pipelined)
+		pipelinedStep();
+	else{
+		evaluate();
+		if(Running) select();
+		if(Running) breed();
+	}
+	if(Running) Generation++;
+	RunTicks += GetTickCount() - Start;
+
+	EvalFunc->getMemoCounts(MemoLookups, MemoFound);
+	MemoLookups -= LookupsBefore;
+	MemoFound -= FoundBefore;
+}
+
+
+/*******************************
+Migration Methods
+*******************************/
+vector<COUNTER> CPopulation::getElite(COUNTER Count) const{
+	//Best graded individuals first; offspring not graded yet are left out
+	vector< pair<double, COUNTER> > Graded;
+	for(COUNTER i=0; i<Individuals.size(); i++)
+		if(Individuals[i] && (Individuals[i]->Fitness->getAdjustedFitness() > 0.0f))
+			Graded.push_back(pair<double, COUNTER>(Individuals[i]->Fitness->getStandardizedFitness(), i));
+	sort(Graded.begin(), Graded.end());
+
+	vector<COUNTER> Elite;
+	for(COUNTER k=0; (k<Count)&&(k<Graded.size()); k++)
+		Elite.push_back(Graded[k].second);
+	return Elite;
+}
+
+void CPopulation::replaceTail(vector<CDNAStatement*>& Immigrants){
+	//Immigrants take the last slots, which hold the newest offspring, and are
+	//graded with everyone else at the next evaluation. Takes ownership.
+	COUNTER Size = (COUNTER)Individuals.size();
+	for(COUNTER k=0; k<Immigrants.size(); k++){
+		if(k >= Size){
+			delete Immigrants[k];
+			continue;
+		}
+		COUNTER Slot = Size - 1 - k;
+		if(Individuals[Slot]) delete Individuals[Slot];
+		Individuals[Slot] = Immigrants[k];
+		Immigrants[k] = NULL;
+
+		//Steady-state and pipelined populations are already graded
+		//for their next step, so immigrants are graded now
+		if(AllGraded){
+			try{
+				EvalFunc->EvaluateCDNA(Individuals[Slot]);
+			}
+			catch(CString Mssg){
+				for(COUNTER j=k+1; j<Immigrants.size(); j++)
+					delete Immigrants[j];
+				Immigrants.clear();
+				throw Mssg;
+			}
+			Evaluations += 1.0f;
+		}
+	}
+	Immigrants.clear();
+}
+
+
+/*******************************
+Statistics
+*******************************/
+double CPopulation::getBestFitness() const{
+	if(BestIndex >= Individuals.size() || !Individuals[BestIndex]) return INFINITY_GRADE;
+	return Individuals[BestIndex]->Fitness->getStandardizedFitness();
+}
+
+CString CPopulation::getStatistics() const{
+	CString Stats;
+	Stats.Format("Generation %d: %d distinct individuals out of %d",
+		Generation, EquivalenceGroups, Individuals.size());
+
+	if(Settings.TournamentSize > 1){
+		CString Racing;
+		Racing.Format(", racing and grading survivors ran %.0f fewer case evaluations than grading everyone", RacingCasesSaved);
+		Stats += Racing;
+	}
+
+	if(EvalFunc){
+		CString Nodes;
+		Nodes.Format(", %.0f node evaluations (%.0f saved)",
+			(double)EvalFunc->getNodeEvaluations(), (double)EvalFunc->getNodeEvaluationsSaved());
+		Stats += Nodes;
+	}
+
+	if(MemoLookups){
+		CString Memo;
+		Memo.Format(", fitness memo hit %.0f%% of %.0f lookups last generation",
+			(100.0f*MemoFound)/MemoLookups, (double)MemoLookups);
+		Stats += Memo;
+	}
+
+	if(RunTicks){
+		CString Rate;
+		Rate.Format(", %.0f evaluations/s", Evaluations*1000.0f/RunTicks);
+		Stats += Rate;
+	}
+
+	if(BatchTicks && WorkerIdleTicks.size()){
+		CString Idle(_T(", worker idle time"));
+		for(COUNTER w=0; w<WorkerIdleTicks.size(); w++){
+			CString Share;
+			Share.Format(" %.0f%%", (100.0f*WorkerIdleTicks[w])/BatchTicks);
+			Idle += Share;
+		}
+		Stats += Idle;
+	}
+
+	if(Pool && (Pool->getNodeCount() > 1)){
+		CString Numa;
+		Numa.Format(", %d of %d pool tasks ran off their NUMA node (%d nodes)",
+			Pool->getCrossNodeTasks(), Pool->getHomedTasks(), Pool->getNodeCount());
+		Stats += Numa;
+	}
+
+	if(EvalFunc && (EvalFunc->getBudgetSpent() != BUDGET_NONE)){
+		static const char* Budgets[] = { "", "time", "node", "case" };
+		CString Budget;
+		Budget.Format(", stopped by its %s budget", Budgets[EvalFunc->getBudgetSpent()]);
+		Stats += Budget;
+	}
+	return Stats;
+}
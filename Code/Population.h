@@ -0,0 +1,142 @@
+#pragma once
+
+#include "FitnessClass.h"
+
+#define STEADYTOURNAMENTSIZE 4
+//Steady-state tournament size when TournamentSize is below 2
+
+#define PIPELINEDEPTH 4
+//Offspring bred ahead of their grading, per worker
+
+class CDNAStatement;
+class CEvaluatingFunction;
+class CCaseTable;
+class CPoolTask;
+class CThreadPool;
+class CEquivalenceClasses;
+
+/*******************************
+Settings of an evolution run
+*******************************/
+struct CRunSettings{
+	COUNTER PopulationSize;
+	COUNTER SelectionSize;
+	COUNTER TournamentSize;
+	COUNTER MaxDepth;
+	COUNTER CrossMaxDepth;
+	COUNTER TreeDensity;
+	double MutProb;
+	COUNTER CaseCount;
+	double RangeMin;
+	double RangeMax;
+	COUNTER RunSeed;		//every random stream of a run derives from it, see CRandom
+	bool SteadyState;		//replace losers one by one instead of by generations
+	bool Pipelined;			//grade offspring while the rest are still bred
+
+	//The run stops once one is spent, 0 for none, see CEvaluatingFunction::setBudget
+	double TimeBudget;		//seconds spent in step
+	double NodeBudget;		//node evaluations
+	double CaseBudget;		//case evaluations
+
+	//Fitness cases read from a CSV file instead of drawn from the built-in target.
+	//A plain array, so the settings still copy into shared memory for island processes
+	TCHAR DataFile[MAX_PATH];	//empty for the built-in target
+	COUNTER XColumns[MAXVARIABLES];	//of the inputs X_1, X_2..., the first column is 0
+	COUNTER VariableCount;	//inputs read, 1 for the built-in target
+	COUNTER YColumn;		//of the target
+	COUNTER StreamBudget;	//megabytes of row buffers to stream a binary case file through, 0 to map it whole
+
+	//Workers of the pool grading the run. Runs differing only in it end alike, bit for
+	//bit, but for steady-state runs, whose workers replace slots as they finish
+	COUNTER WorkerCount;	//0: the shared pool, or inline in a batch
+
+	CRunSettings();
+};
+
+
+/*******************************
+Told about batches while a population
+waits on them, e.g. to keep a UI alive.
+*******************************/
+class CRunObserver
+{
+public:
+	virtual ~CRunObserver(){};
+	virtual void waiting(COUNTER Done, COUNTER Total) = 0;
+};
+
+
+/*******************************
+A population and its evaluate, select
+and breed loop, free of any UI. Batches
+go to a thread pool when one is given,
+otherwise they run on the calling thread.
+*******************************/
+class CPopulation
+{
+	CRunSettings Settings;
+	unsigned __int64 Seed;
+	volatile bool Running;				//read by pool workers
+	CThreadPool* Pool;
+	CRunObserver* Observer;
+	CCaseTable* Cases;					//NULL for the built-in target
+
+	//Run statistics
+	COUNTER Generation;
+	COUNTER EquivalenceGroups;
+	double RacingCasesSaved;
+	double Evaluations;					//individuals graded
+	DWORD RunTicks;						//spent in step
+	unsigned __int64 BatchTicks;		//spent waiting on pool batches, in CThreadPool::getTicks
+	vector<unsigned __int64> WorkerIdleTicks;	//of every pool worker during those batches
+	unsigned __int64 MemoLookups;		//fitness memo, over the last step
+	unsigned __int64 MemoFound;
+	bool AllGraded;						//every slot graded on the current cases
+	CDNAStatement* BestSoFar;			//of the last population graded in full, NULL before
+
+	//Steady state
+	vector<LONG> SlotLocks;				//spinlock per slot of Individuals
+
+	COUNTER getTaskCount(COUNTER Size) const;
+	void runTasks(vector<CPoolTask*>& Tasks, volatile LONG& Done, COUNTER Total);
+	void recordIdle(const vector<unsigned __int64>& BusyBefore, unsigned __int64 Start);
+	void generateCases(COUNTER CaseGeneration);
+	COUNTER evaluateStreamed(const vector<COUNTER>& Representatives, const CEquivalenceClasses& Groups);
+	void findBest();
+	void keepBest();
+	bool applyBudget();
+	void replaceBySurvivors(vector<CDNAStatement*>& Survivors);
+	void steadyStep();
+	COUNTER prepareParents(vector<double>& Weights, int& TotFit);
+	void pipelinedStep();
+
+public:
+	vector<CDNAStatement*> Individuals;
+	COUNTER BestIndex;
+	CEvaluatingFunction* EvalFunc;
+	CFitnessSummary Summary;		//totals of Individuals, reduced after each evaluation
+
+	CPopulation(const CRunSettings& S, CThreadPool* P = NULL, CRunObserver* Obs = NULL, COUNTER Island = 0);
+	~CPopulation();
+
+	void evaluate(bool NewCases = true);
+	void select();
+	void raceSelect();
+	void breed();
+	void step();						//one generation, or as many replacements in steady state
+
+	//Batches stop early once running is cleared, from any thread
+	void setRunning(bool R){ Running = R; };
+	bool isRunning() const { return Running; };
+	void attach(CThreadPool* P, CRunObserver* Obs){ Pool = P; Observer = Obs; };
+
+	//Migration
+	vector<COUNTER> getElite(COUNTER Count) const;
+	void replaceTail(vector<CDNAStatement*>& Immigrants);
+
+	const CRunSettings& getSettings() const { return Settings; };
+	COUNTER getGeneration() const { return Generation; };
+	double getBestFitness() const;
+	const CDNAStatement* getBestSoFar() const { return BestSoFar; };		//what a stopped run reports
+	CString getStatistics() const;
+};
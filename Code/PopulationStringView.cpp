@@ -57,7 +57,10 @@ void CPopulationStringView::UpdateList(){
 	ListCtrl->DeleteAllItems();
 
 
-	for(COUNTER i=0; i<DocPtr->m_Population.size(); i++){ 
+	if(!DocPtr->m_Snapshot) return;
+	const vector<CDNAStatement*>& Individuals = DocPtr->m_Snapshot->Individuals;
+
+	for(COUNTER i=0; i<Individuals.size(); i++){ 
 
 		ListCtrl->InsertItem(
 		LVIF_TEXT|LVIF_STATE, i, strText, 
@@ -66,10 +69,10 @@ void CPopulationStringView::UpdateList(){
 		
 		strText.Format(TEXT("%d"), i);
 		ListCtrl->SetItemText(i, 0,strText);
-		if(DocPtr->m_Population[i]){
-			strText.Format(TEXT("%f"), DocPtr->m_Population[i]->Fitness->getNormalizedFitness());
+		if(Individuals[i]){
+			strText.Format(TEXT("%f"), Individuals[i]->Fitness->getNormalizedFitness());
 			ListCtrl->SetItemText(i, 1, strText);
-			ListCtrl->SetItemText(i, 2, DocPtr->m_Population[i]->toString());
+			ListCtrl->SetItemText(i, 2, Individuals[i]->toString());
 		}
 		else{
 			ListCtrl->SetItemText(i, 1, _T("----"));
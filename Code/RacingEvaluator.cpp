@@ -0,0 +1,171 @@
+#include "StdAfx.h"
+#include "FitnessClass.h"
+#include "DNAStatement.h"
+#include ".\racingevaluator.h"
+
+
+/*******************************
+Admin Methods
+*******************************/
+CRacingEvaluator::CRacingEvaluator(CEvaluatingFunction* Eval, const vector<CDNAStatement*>& Pop):
+EvalFunc(Eval), Population(Pop), CasesX(Eval->getCasesX()), CasesY(Eval->getCasesY()),
+CaseCount(Eval->getCaseCount()), Stride(1), VariableCount(Eval->getVariableCount()){
+
+	CRaceEntry Empty;
+	Empty.Compiled = NULL;
+	Empty.Spent = 0;
+	Empty.Undefined = false;
+	Entries.assign(Population.size(), Empty);
+
+	//Cases are generated in increasing x; racing needs them spread over the
+	//range from the first block on, so they are visited with a stride prime
+	//to their number. Only the cases run are ever read.
+	COUNTER N = CaseCount;
+	Stride = (COUNTER)(0.618f*N) + 1;
+	while(N > 1){
+		COUNTER a = N, b = Stride;
+		while(b){
+			COUNTER r = a % b;
+			a = b;
+			b = r;
+		}
+		if(a == 1) break;
+		Stride++;
+	}
+}
+
+CRacingEvaluator::~CRacingEvaluator(){
+	for(COUNTER i=0; i<Entries.size(); i++)
+		if(Entries[i].Compiled) delete Entries[i].Compiled;
+}
+
+
+/*******************************
+Racing Methods
+*******************************/
+void CRacingEvaluator::advance(COUNTER i, COUNTER Target){
+	//Brings individual i up to its first Target cases
+	CRaceEntry& E = Entries[i];
+	if(E.Undefined || (E.Errors.Cases >= Target)) return;
+
+	try{
+		if(!E.Compiled){
+			E.Compiled = new CCompiledStatement();
+			E.Compiled->compile(*Population[i]);
+		}
+		//The cases are gathered in racing order a few at a time
+		double Gathered[MAXVARIABLES + 1][RACEGATHERROWS];
+		const double* X[MAXVARIABLES];
+		for(COUNTER v=0; v<VariableCount; v++)
+			X[v] = Gathered[v];
+
+		COUNTER Beg = E.Errors.Cases;
+		E.Spent += Target - Beg;
+		while(Beg < Target){
+			COUNTER Count = (Target - Beg < RACEGATHERROWS) ? Target - Beg : RACEGATHERROWS;
+			for(COUNTER k=0; k<Count; k++){
+				COUNTER j = (COUNTER)(((unsigned __int64)(Beg + k)*Stride) % CaseCount);
+				for(COUNTER v=0; v<VariableCount; v++)
+					Gathered[v][k] = CasesX[v][j];
+				Gathered[MAXVARIABLES][k] = CasesY[j];
+			}
+			EvalFunc->EvaluateCases(*E.Compiled, X, Gathered[MAXVARIABLES], Count, E.Errors);
+			Beg += Count;
+		}
+	}
+	catch(CString Mess){
+		if((Mess != CString(_T("UNDEF"))) && (Mess != CString(_T("CANCELLED")))){
+			Mess += _T("\r\n -->At CRacingEvaluator::advance");
+			throw Mess;
+		}
+		E.Undefined = true;
+	}
+}
+
+double CRacingEvaluator::mean(COUNTER i) const{
+	const CCaseErrors& E = Entries[i].Errors;
+	return E.Cases ? E.getSum() / E.Cases : 0.0f;
+}
+
+double CRacingEvaluator::halfWidth(COUNTER i) const{
+	const CCaseErrors& E = Entries[i].Errors;
+	if(E.Cases >= CaseCount) return 0.0f;		//exact
+	if(E.Cases < 2) return 1.0e300;
+
+	double n = (double)E.Cases;
+	double Var = (E.SumSq - E.getSum()*E.getSum()/n) / (n - 1.0f);
+	if(Var < 0.0f) Var = 0.0f;
+	return RACECONFIDENCE*sqrt(Var/n);
+}
+
+COUNTER CRacingEvaluator::race(const vector<COUNTER>& Candidates){
+	//Returns the population index of the candidate with the lowest mean error
+	COUNTER N = CaseCount;
+	if(!N) return Candidates[0];
+
+	vector<COUNTER> Alive;
+	for(COUNTER c=0; c<Candidates.size(); c++){
+		advance(Candidates[c], 1);
+		if(!Entries[Candidates[c]].Undefined) Alive.push_back(Candidates[c]);
+	}
+	if(Alive.empty()) return Candidates[0];
+
+	COUNTER Target = 1;
+	while((Alive.size() > 1) && (Target < N)){
+		Target = (Target + RACEBLOCK < N) ? Target + RACEBLOCK : N;
+
+		vector<COUNTER> Defined;
+		for(COUNTER a=0; a<Alive.size(); a++){
+			advance(Alive[a], Target);
+			if(!Entries[Alive[a]].Undefined) Defined.push_back(Alive[a]);
+		}
+		if(Defined.empty()) return Candidates[0];
+
+		COUNTER Best = Defined[0];
+		for(COUNTER a=1; a<Defined.size(); a++)
+			if(mean(Defined[a]) < mean(Best)) Best = Defined[a];
+		double Upper = mean(Best) + halfWidth(Best);
+
+		//Drop every candidate whose error is worse than the leader's beyond doubt
+		Alive.clear();
+		for(COUNTER a=0; a<Defined.size(); a++)
+			if(mean(Defined[a]) - halfWidth(Defined[a]) <= Upper)
+				Alive.push_back(Defined[a]);
+	}
+
+	COUNTER Winner = Alive[0];
+	for(COUNTER a=1; a<Alive.size(); a++)
+		if(mean(Alive[a]) < mean(Winner)) Winner = Alive[a];
+	return Winner;
+}
+
+void CRacingEvaluator::finish(COUNTER i){
+	//Only the cases not raced yet are run
+	advance(i, CaseCount);
+}
+
+void CRacingEvaluator::grade(COUNTER i, CDNAStatement* Stat){
+	const CRaceEntry& E = Entries[i];
+	ASSERT(E.Undefined || (E.Errors.Cases == CaseCount));
+	EvalFunc->setGrade(Stat, E.Errors, E.Undefined, 1.0f);
+}
+
+
+/*******************************
+Statistics
+*******************************/
+unsigned __int64 CRacingEvaluator::getCasesSpent() const{
+	unsigned __int64 Spent = 0;
+	for(COUNTER i=0; i<Entries.size(); i++)
+		Spent += Entries[i].Spent;
+	return Spent;
+}
+
+unsigned __int64 CRacingEvaluator::getCasesSaved() const{
+	//Against scoring every individual on every case; no individual
+	//is run on more cases than there are
+	unsigned __int64 Full = 0;
+	for(COUNTER i=0; i<Population.size(); i++)
+		if(Population[i]) Full += CaseCount;
+	return Full - getCasesSpent();
+}
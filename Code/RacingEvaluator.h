@@ -0,0 +1,65 @@
+#pragma once
+
+#include "EvaluatingFunction.h"
+
+#define RACEBLOCK 8
+//Fitness cases added to every surviving candidate per racing round
+
+#define RACEGATHERROWS PLANBLOCK
+//Fitness cases gathered in racing order per call to EvaluateCases
+
+#define RACECONFIDENCE (double) 2.576f
+//Half width of the confidence interval on a mean error, in standard errors (99%)
+
+#define DEFAULTTOURNAMENTSIZE 0
+//Racing tournaments are off (roulette selection) unless a size above 1 is set
+
+class CDNAStatement;
+
+struct CRaceEntry{
+	CCompiledStatement* Compiled;
+	CCaseErrors Errors;
+	COUNTER Spent;			//cases run, including those of a block cut short
+	bool Undefined;
+};
+
+
+/*******************************
+Racing evaluator: finds the best of a few
+candidates without scoring all of them on
+every fitness case. Candidates are run in
+blocks of RACEBLOCK cases and dropped as soon
+as their mean error is worse than the best
+one's beyond a t-test bound. Partial scores
+are kept per individual across races, and
+winners are finished on the remaining cases
+for their grade.
+*******************************/
+class CRacingEvaluator
+{
+	CEvaluatingFunction* EvalFunc;
+	const vector<CDNAStatement*>& Population;
+	vector<CRaceEntry> Entries;
+	//The fitness cases are read in place, case i of the race being case
+	//i*Stride mod CaseCount of the evaluator
+	const double* const* CasesX;
+	const double* CasesY;
+	COUNTER CaseCount;
+	COUNTER Stride;
+	COUNTER VariableCount;
+
+	void advance(COUNTER i, COUNTER Target);
+	double mean(COUNTER i) const;
+	double halfWidth(COUNTER i) const;
+
+public:
+	CRacingEvaluator(CEvaluatingFunction* Eval, const vector<CDNAStatement*>& Pop);
+	~CRacingEvaluator();
+
+	COUNTER race(const vector<COUNTER>& Candidates);
+	void finish(COUNTER i);				//distinct individuals may be finished on different threads
+	void grade(COUNTER i, CDNAStatement* Stat);	//once finished, as EvaluateCDNA would
+
+	unsigned __int64 getCasesSpent() const;
+	unsigned __int64 getCasesSaved() const;
+};
@@ -0,0 +1,110 @@
+#include "StdAfx.h"
+#include "ThreadPool.h"
+#include ".\random.h"
+
+static __declspec(thread) CRandom* Current = NULL;
+static CRandom MainStream;
+
+static const unsigned __int64 GOLDENGAMMA = ((unsigned __int64)0x9E3779B9 << 32) | 0x7F4A7C15;
+static const unsigned __int64 MIX1 = ((unsigned __int64)0xBF58476D << 32) | 0x1CE4E5B9;
+static const unsigned __int64 MIX2 = ((unsigned __int64)0x94D049BB << 32) | 0x133111EB;
+
+static inline unsigned __int64 Rotl(unsigned __int64 x, int k){
+	return (x << k) | (x >> (64 - k));
+}
+
+static unsigned __int64 SplitMix(unsigned __int64& State){
+	//splitmix64: spreads any seed over the whole xoshiro state
+	unsigned __int64 z = (State += GOLDENGAMMA);
+	z = (z ^ (z >> 30)) * MIX1;
+	z = (z ^ (z >> 27)) * MIX2;
+	return z ^ (z >> 31);
+}
+
+
+/*******************************
+Admin Methods
+*******************************/
+CRandom::CRandom(unsigned __int64 Seed){
+	seed(Seed);
+}
+
+CRandom::CRandom(unsigned __int64 RunSeed, RANDOMSTREAM Stream, COUNTER Generation, COUNTER Index){
+	//Each key is folded in through a full splitmix round, so neighbouring
+	//generations or individuals get unrelated streams.
+	unsigned __int64 Key = RunSeed;
+	unsigned __int64 h = SplitMix(Key);
+	Key = h ^ (unsigned __int64)Stream;
+	h = SplitMix(Key);
+	Key = h ^ (unsigned __int64)Generation;
+	h = SplitMix(Key);
+	Key = h ^ (unsigned __int64)Index;
+	seed(SplitMix(Key));
+}
+
+void CRandom::seed(unsigned __int64 Seed){
+	for(COUNTER i=0; i<4; i++)
+		S[i] = SplitMix(Seed);
+}
+
+
+/*******************************
+Drawing Methods
+*******************************/
+unsigned __int64 CRandom::next(){
+	unsigned __int64 Res = Rotl(S[1]*5, 7)*9;
+	unsigned __int64 t = S[1] << 17;
+
+	S[2] ^= S[0];
+	S[3] ^= S[1];
+	S[1] ^= S[2];
+	S[0] ^= S[3];
+	S[2] ^= t;
+	S[3] = Rotl(S[3], 45);
+
+	return Res;
+}
+
+COUNTER CRandom::below(COUNTER n){
+	//Multiply-shift on the high 32 bits, rejecting the few low products
+	//that would favour some results (Lemire)
+	if(n < 2) return 0;
+
+	unsigned __int64 m = (next() >> 32) * (unsigned __int64)n;
+	COUNTER Low = (COUNTER)m;
+	if(Low < n){
+		COUNTER Threshold = (COUNTER)(0u - n) % n;
+		while(Low < Threshold){
+			m = (next() >> 32) * (unsigned __int64)n;
+			Low = (COUNTER)m;
+		}
+	}
+	return (COUNTER)(m >> 32);
+}
+
+double CRandom::uniform(){
+	return (double)(__int64)(next() >> 11) * (1.0f/9007199254740992.0f);
+}
+
+
+/*******************************
+Thread Streams
+*******************************/
+CRandom& CRandom::getMain(){
+	return MainStream;
+}
+
+CRandom& CRandom::current(){
+	//Pool tasks must open a scope on their own stream
+	ASSERT(Current || (CThreadPool::getCurrentWorker() < 0));
+	return Current ? *Current : MainStream;
+}
+
+CRandomScope::CRandomScope(CRandom& R):
+Previous(Current){
+	Current = &R;
+}
+
+CRandomScope::~CRandomScope(){
+	Current = Previous;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+enum RANDOMSTREAM{
+	STREAM_MAIN = 0,		//UI thread, anything outside a scope
+	STREAM_GROW,			//initial population, per individual
+	STREAM_CASES,			//fitness cases, per generation
+	STREAM_SELECT,			//survivor selection, per generation
+	STREAM_OFFSPRING,		//parent picks, crossover and mutation, per offspring slot
+	STREAM_ISLAND,			//seed of each island, per island
+	STREAM_MIGRATION,		//random topology, per generation and island
+	STREAM_STEADY,			//steady-state workers, per epoch and task
+};
+
+
+/*******************************
+xoshiro256** generator. Streams are
+derived from the run seed, a purpose,
+the generation and an individual index,
+so a run draws the same numbers
+whichever thread does the drawing.
+*******************************/
+class CRandom
+{
+	unsigned __int64 S[4];
+
+public:
+	CRandom(unsigned __int64 Seed = 0);
+	CRandom(unsigned __int64 RunSeed, RANDOMSTREAM Stream, COUNTER Generation, COUNTER Index);
+	void seed(unsigned __int64 Seed);
+
+	unsigned __int64 next();
+	COUNTER below(COUNTER n);			//unbiased, in [0, n)
+	double uniform();					//in [0, 1)
+
+	static CRandom& current();			//stream of the calling thread
+	static CRandom& getMain();
+};
+
+
+/*******************************
+Makes a stream current on the calling
+thread for the lifetime of the scope.
+*******************************/
+class CRandomScope
+{
+	CRandom* Previous;
+
+public:
+	CRandomScope(CRandom& R);
+	~CRandomScope();
+};
@@ -0,0 +1,380 @@
+#include "StdAfx.h"
+#include "FitnessClass.h"
+#include "DNAStatement.h"
+#include ".\rationalform.h"
+
+
+/*******************************
+Polynomial Admin Methods
+*******************************/
+CPolynomial::CPolynomial(double c){
+	if(c != 0.0f) Coef.push_back(c);
+}
+
+CPolynomial CPolynomial::X(){
+	CPolynomial P;
+	P.Coef.push_back(0.0f);
+	P.Coef.push_back(1.0f);
+	return P;
+}
+
+void CPolynomial::trim(){
+	while(Coef.size() && (Coef.back() == 0.0f))
+		Coef.pop_back();
+}
+
+bool CPolynomial::isExact() const{
+	for(COUNTER k=0; k<Coef.size(); k++)
+		if(fabs(Coef[k]) >= EXACTCOEFLIMIT) return false;
+	return true;
+}
+
+
+/*******************************
+Polynomial Arithmetic
+*******************************/
+CPolynomial CPolynomial::operator+(const CPolynomial& P) const{
+	CPolynomial Res(*this);
+	if(Res.Coef.size() < P.Coef.size()) Res.Coef.resize(P.Coef.size(), 0.0f);
+	for(COUNTER k=0; k<P.Coef.size(); k++)
+		Res.Coef[k] += P.Coef[k];
+	Res.trim();
+	return Res;
+}
+
+CPolynomial CPolynomial::operator-(const CPolynomial& P) const{
+	return (*this) + (P * -1.0f);
+}
+
+CPolynomial CPolynomial::operator*(const CPolynomial& P) const{
+	CPolynomial Res;
+	if(isZero() || P.isZero()) return Res;
+
+	Res.Coef.resize(Coef.size() + P.Coef.size() - 1, 0.0f);
+	for(COUNTER i=0; i<Coef.size(); i++)
+		for(COUNTER j=0; j<P.Coef.size(); j++)
+			Res.Coef[i+j] += Coef[i]*P.Coef[j];
+	Res.trim();
+	return Res;
+}
+
+CPolynomial CPolynomial::operator*(double c) const{
+	CPolynomial Res(*this);
+	for(COUNTER k=0; k<Res.Coef.size(); k++)
+		Res.Coef[k] *= c;
+	Res.trim();
+	return Res;
+}
+
+bool CPolynomial::multiply(const CPolynomial& A, const CPolynomial& B, CPolynomial& P){
+	//Every partial sum of a coefficient is bounded by the same sum over the
+	//coefficient magnitudes, which cannot round below the limit once past it
+	for(COUNTER n=0; n+1<A.Coef.size()+B.Coef.size(); n++){
+		double Bound = 0.0f;
+		for(COUNTER i=0; (i<A.Coef.size())&&(i<=n); i++)
+			if(n-i < B.Coef.size()) Bound += fabs(A.Coef[i])*fabs(B.Coef[n-i]);
+		if(Bound >= EXACTCOEFLIMIT) return false;
+	}
+	P = A*B;
+	return true;
+}
+
+bool CPolynomial::add(const CPolynomial& A, const CPolynomial& B, bool Subtract, CPolynomial& S){
+	for(unsigned int k=0; (k<A.Coef.size())||(k<B.Coef.size()); k++)
+		if(fabs(A.getCoef(k)) + fabs(B.getCoef(k)) >= EXACTCOEFLIMIT) return false;
+	S = Subtract ? A - B : A + B;
+	return true;
+}
+
+double CPolynomial::content() const{
+	//gcd of the integer coefficients
+	double G = 0.0f;
+	for(COUNTER k=0; k<Coef.size(); k++){
+		double a = fabs(Coef[k]);
+		while(a != 0.0f){
+			double r = fmod(G, a);
+			G = a;
+			a = r;
+		}
+	}
+	return G;
+}
+
+unsigned int CPolynomial::lowestPower() const{
+	unsigned int k = 0;
+	while((k < Coef.size()) && (Coef[k] == 0.0f)) k++;
+	return k;
+}
+
+void CPolynomial::shiftDown(unsigned int k){
+	if(!k) return;
+	if(k >= Coef.size()) Coef.clear();
+	else Coef.erase(Coef.begin(), Coef.begin() + k);
+}
+
+void CPolynomial::divideBy(double c){
+	for(COUNTER k=0; k<Coef.size(); k++)
+		Coef[k] /= c;
+}
+
+bool CPolynomial::divideExact(const CPolynomial& D, CPolynomial& Quotient) const{
+	//Long division over the integers, fails if a quotient coefficient is not integral
+	//or if D does not divide this polynomial.
+	if(D.isZero()) return false;
+
+	CPolynomial R(*this);
+	Quotient = CPolynomial();
+	if(R.Coef.size() >= D.Coef.size())
+		Quotient.Coef.resize(R.Coef.size() - D.Coef.size() + 1, 0.0f);
+
+	while(!R.isZero() && (R.Coef.size() >= D.Coef.size())){
+		double q = R.Coef.back() / D.Coef.back();
+		if(q != floor(q)) return false;
+
+		unsigned int shift = (unsigned int)(R.Coef.size() - D.Coef.size());
+		Quotient.Coef[shift] = q;
+		for(COUNTER k=0; k<D.Coef.size(); k++)
+			if(fabs(R.Coef[k+shift]) + fabs(q)*fabs(D.Coef[k]) >= EXACTCOEFLIMIT) return false;
+		for(COUNTER k=0; k<D.Coef.size(); k++)
+			R.Coef[k+shift] -= q*D.Coef[k];
+		R.Coef.back() = 0.0f;
+		R.trim();
+	}
+	Quotient.trim();
+	return R.isZero();
+}
+
+bool CPolynomial::pseudoRemainder(const CPolynomial& D, CPolynomial& Rem) const{
+	//lc(D)^k * this = Q*D + Rem, computed without leaving the integers
+	if(D.isZero()) return false;
+
+	Rem = *this;
+	double Lead = D.Coef.back();
+	while(!Rem.isZero() && (Rem.Coef.size() >= D.Coef.size())){
+		double RLead = Rem.Coef.back();
+		unsigned int shift = (unsigned int)(Rem.Coef.size() - D.Coef.size());
+		for(COUNTER k=0; k<Rem.Coef.size(); k++){
+			double Bound = fabs(Rem.Coef[k])*fabs(Lead);
+			if(k >= shift) Bound += fabs(RLead)*fabs(D.Coef[k-shift]);
+			if(Bound >= EXACTCOEFLIMIT) return false;
+		}
+		for(COUNTER k=0; k<Rem.Coef.size(); k++)
+			Rem.Coef[k] *= Lead;
+		for(COUNTER k=0; k<D.Coef.size(); k++)
+			Rem.Coef[k+shift] -= RLead*D.Coef[k];
+		Rem.Coef.back() = 0.0f;
+		Rem.trim();
+
+		double c = Rem.content();
+		if(c > 1.0f) Rem.divideBy(c);
+	}
+	return true;
+}
+
+bool CPolynomial::gcd(const CPolynomial& A, const CPolynomial& B, CPolynomial& G){
+	//Primitive polynomial remainder sequence. Returns false if a coefficient
+	//grows beyond the exact range of a double.
+	CPolynomial U(A), V(B);
+	if(U.isZero() && V.isZero()) return false;
+	if(U.Coef.size() < V.Coef.size()){
+		CPolynomial T(U); U = V; V = T;
+	}
+	if(!U.isZero()) U.divideBy(U.content());
+	if(!V.isZero()) V.divideBy(V.content());
+
+	while(!V.isZero()){
+		CPolynomial R;
+		if(!U.pseudoRemainder(V, R)) return false;
+		U = V;
+		V = R;
+		if(!V.isZero()) V.divideBy(V.content());
+	}
+
+	if(U.getDegree() == 0) U = CPolynomial(1.0f);
+	if(U.getLeading() < 0.0f) U = U * -1.0f;
+	G = U;
+	return true;
+}
+
+CString CPolynomial::toString() const{
+	if(isZero()) return CString(_T("0"));
+
+	CString Res;
+	for(COUNTER k = (COUNTER)Coef.size(); k > 0; k--){
+		double c = Coef[k-1];
+		if(c == 0.0f) continue;
+
+		CString Term;
+		if(Res.GetLength()) Res += (c < 0.0f) ? _T(" - ") : _T(" + ");
+		else if(c < 0.0f) Res += _T("-");
+
+		if((fabs(c) != 1.0f) || (k == 1)) Term.Format("%.0f", fabs(c));
+		if(k > 1){
+			if(Term.GetLength()) Term += _T("*");
+			Term += _T("x");
+		}
+		if(k > 2){
+			CString Power;
+			Power.Format("^%d", k-1);
+			Term += Power;
+		}
+		Res += Term;
+	}
+	return Res;
+}
+
+
+/*******************************
+Rational Form Methods
+*******************************/
+CRationalForm::CRationalForm():
+Num(0.0f), Den(1.0f), Holes(1.0f), Valid(false){
+}
+
+bool CRationalForm::isIdentity() const{
+	return (Num == CPolynomial::X()) && (Den == CPolynomial(1.0f));
+}
+
+bool CRationalForm::normalize(){
+
+	if(Num.isZero()){
+		Den = CPolynomial(1.0f);
+		return true;
+	}
+
+	//Common powers of x
+	unsigned int k = Num.lowestPower();
+	if(Den.lowestPower() < k) k = Den.lowestPower();
+	Num.shiftDown(k);
+	Den.shiftDown(k);
+
+	//Common polynomial factor
+	if(Num.getDegree() && Den.getDegree()){
+		CPolynomial G, QN, QD;
+		if(!CPolynomial::gcd(Num, Den, G)) return false;
+		if(G.getDegree()){
+			if(!Num.divideExact(G, QN) || !Den.divideExact(G, QD)) return false;
+			Num = QN;
+			Den = QD;
+		}
+	}
+
+	//Common integer factor, denominator made positive
+	double a = Num.content();
+	double b = Den.content();
+	while(b != 0.0f){
+		double r = fmod(a, b);
+		a = b;
+		b = r;
+	}
+	if(Den.getLeading() < 0.0f) a = -a;
+	if(a != 1.0f){
+		Num.divideBy(a);
+		Den.divideBy(a);
+	}
+
+	return Num.isExact() && Den.isExact() &&
+		(Num.getDegree() <= MAXRATIONALDEGREE) && (Den.getDegree() <= MAXRATIONALDEGREE);
+}
+
+bool CRationalForm::addHoles(const CPolynomial& P){
+	//Adds the zeros of P that are neither zeros of Den nor holes already
+	if(!P.getDegree()) return true;
+
+	CPolynomial F(P);
+	F.divideBy(F.content());
+	const CPolynomial* Known[2] = { &Den, &Holes };
+	for(COUNTER n=0; n<2; n++){
+		while(F.getDegree() && Known[n]->getDegree()){
+			CPolynomial G, Q;
+			if(!CPolynomial::gcd(F, *Known[n], G)) return false;
+			if(!G.getDegree()) break;
+			if(!F.divideExact(G, Q)) return false;
+			F = Q;
+		}
+	}
+	if(!F.getDegree()) return true;
+
+	CPolynomial H;
+	if(!CPolynomial::multiply(Holes, F, H)) return false;
+	if(H.getLeading() < 0.0f) H = H * -1.0f;
+	Holes = H;
+	return Holes.getDegree() <= MAXRATIONALDEGREE;
+}
+
+bool CRationalForm::combine(GENEStatementType Op, const CRationalForm& A, const CRationalForm& B){
+
+	CPolynomial P, Q;
+	switch(Op){
+		case PLUS:
+		case MINUS:
+			if(!CPolynomial::multiply(A.Num, B.Den, P) || !CPolynomial::multiply(B.Num, A.Den, Q)) return false;
+			if(!CPolynomial::add(P, Q, Op == MINUS, Num)) return false;
+			if(!CPolynomial::multiply(A.Den, B.Den, Den)) return false;
+			break;
+
+		case MULT:
+			if(!CPolynomial::multiply(A.Num, B.Num, Num) || !CPolynomial::multiply(A.Den, B.Den, Den)) return false;
+			break;
+
+		case DIV:
+			//A denominator that is identically zero is UNDEF on every fitness case
+			if(B.Num.isZero()) throw CString(_T("UNDEF"));
+			if(!CPolynomial::multiply(A.Num, B.Den, Num) || !CPolynomial::multiply(A.Den, B.Num, Den)) return false;
+			break;
+
+		default:{
+			CString Xcept;
+			Xcept.Format("Unknown statement [%d] at CRationalForm::combine", (COUNTER)Op);
+			throw Xcept;
+		}
+	}
+	if(!normalize()) return false;
+
+	//Undefined wherever A or B is, and for DIV wherever B is zero
+	Holes = CPolynomial(1.0f);
+	return addHoles(A.Den) && addHoles(A.Holes) && addHoles(B.Den) && addHoles(B.Holes) &&
+		((Op != DIV) || addHoles(B.Num));
+}
+
+bool CRationalForm::compile(const CDNAStatement& S){
+	//Returns false when the normal form is not worth keeping (degree above
+	//MAXRATIONALDEGREE or coefficients beyond exact double range); the caller
+	//then falls back to CDNAStatement::Eval. Throws "UNDEF" like Eval would.
+	Valid = false;
+	Valid = build(S);
+	return Valid;
+}
+
+bool CRationalForm::build(const CDNAStatement& S){
+	GENEStatementType T = S.getRoot();
+	Holes = CPolynomial(1.0f);
+
+	if(T == UNDEF) throw CString(_T("UNDEF"));
+
+	//The form is a polynomial in X_1 alone: trees reading any other input run as plans
+	if(CFunctionSet::isVariable(T) && (T != X_1)) return false;
+
+	if(T == X_1){
+		Num = CPolynomial::X();
+		Den = CPolynomial(1.0f);
+		return true;
+	}
+
+	if(CFunctionSet::isTerminal(T)){
+		Num = CPolynomial(CDNAStatement::FromConst(T).x());
+		Den = CPolynomial(1.0f);
+		return true;
+	}
+
+	CRationalForm A, B;
+	if(!A.build(S.getBranch(0))) return false;
+	if(!B.build(S.getBranch(1))) return false;
+	return combine(T, A, B);
+}
+
+CString CRationalForm::toString() const{
+	if(Den == CPolynomial(1.0f))
+		return Num.toString();
+	return CString(_T("(")) + Num.toString() + CString(_T(")/(")) + Den.toString() + CString(_T(")"));
+}
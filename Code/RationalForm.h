@@ -0,0 +1,112 @@
+#pragma once
+
+#define MAXRATIONALDEGREE 16
+//Above this degree the normal form is dropped and the tree is evaluated as is
+
+#define EXACTCOEFLIMIT (double) 9007199254740992.0
+//2^53, largest magnitude for which every integer coefficient is exact in a double
+
+
+class CDNAStatement;
+
+/*******************************
+Polynomial in X_1 with integer
+coefficients stored as doubles.
+Coef[k] multiplies x^k.
+*******************************/
+class CPolynomial
+{
+	vector<double> Coef;
+
+	void trim();
+
+public:
+	CPolynomial(double c = 0.0f);
+	static CPolynomial X();
+
+	bool isZero() const { return Coef.empty(); };
+	bool isExact() const;					//every coefficient below EXACTCOEFLIMIT
+	unsigned int getDegree() const { return Coef.size() ? (unsigned int)Coef.size()-1 : 0; };
+	double getCoef(unsigned int k) const { return (k < Coef.size()) ? Coef[k] : 0.0f; };
+	double getLeading() const { return Coef.size() ? Coef.back() : 0.0f; };
+
+	CPolynomial operator+(const CPolynomial& P) const;
+	CPolynomial operator-(const CPolynomial& P) const;
+	CPolynomial operator*(const CPolynomial& P) const;
+	CPolynomial operator*(double c) const;
+	bool operator==(const CPolynomial& P) const { return Coef == P.Coef; };
+
+	//As the operators, false when a partial sum could leave the exact range
+	static bool multiply(const CPolynomial& A, const CPolynomial& B, CPolynomial& P);
+	static bool add(const CPolynomial& A, const CPolynomial& B, bool Subtract, CPolynomial& S);
+
+	double content() const;
+	unsigned int lowestPower() const;
+	void shiftDown(unsigned int k);
+	void divideBy(double c);
+	bool divideExact(const CPolynomial& D, CPolynomial& Quotient) const;
+	bool pseudoRemainder(const CPolynomial& D, CPolynomial& Rem) const;
+	static bool gcd(const CPolynomial& A, const CPolynomial& B, CPolynomial& G);
+
+	inline double Eval(double x) const{
+		//Horner's scheme
+		double Res = 0.0f;
+		for(COUNTER k = (COUNTER)Coef.size(); k > 0; k--)
+			Res = Res*x + Coef[k-1];
+		return Res;
+	};
+
+	CString toString() const;
+};
+
+
+/*******************************
+Normal form P(x)/Q(x) of an individual.
+Every tree over {PLUS, MINUS, MULT, DIV},
+X_1 and integer constants is exactly
+such a rational function.
+The tree is undefined wherever one of
+its divisors is zero, and reducing
+P/Q may cancel such a zero, as in
+x/x. The divisors cancelled are kept
+in Holes, so the form is undefined at
+the zeros of Q and of Holes: at the
+same cases as the tree.
+*******************************/
+class CRationalForm
+{
+	CPolynomial Num;
+	CPolynomial Den;
+	CPolynomial Holes;						//1 when nothing cancelled
+	bool Valid;
+
+	bool build(const CDNAStatement& S);
+	bool combine(GENEStatementType Op, const CRationalForm& A, const CRationalForm& B);
+	bool normalize();
+	bool addHoles(const CPolynomial& P);
+
+public:
+	CRationalForm();
+
+	bool compile(const CDNAStatement& S);
+	bool isValid() const { return Valid; };			//the last compile returned true
+
+	const CPolynomial& getNumerator() const { return Num; };
+	const CPolynomial& getDenominator() const { return Den; };
+	unsigned int getCost() const {
+		return Num.getDegree() + Den.getDegree() + 2 + (hasHoles() ? Holes.getDegree() + 1 : 0);
+	};
+
+	bool isConstant() const { return (Num.getDegree() == 0) && (Den.getDegree() == 0); };
+	bool isIdentity() const;
+	bool hasHoles() const { return Holes.getDegree() > 0; };
+	bool operator==(const CRationalForm& R) const { return (Num == R.Num)&&(Den == R.Den)&&(Holes == R.Holes); };
+
+	inline double Eval(double x) const{
+		double D = Den.Eval(x);
+		if((D == 0.0f) || (hasHoles() && (Holes.Eval(x) == 0.0f))) throw CString(_T("UNDEF"));
+		return Num.Eval(x) / D;
+	};
+
+	CString toString() const;
+};
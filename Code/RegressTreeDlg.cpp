@@ -83,16 +83,20 @@ void CRegressTreeDlg::ExitError(CString ErrMsg){
 
 void CRegressTreeDlg::OnBnClickedButton1(){
 	try{
+		//Values of X_1, X_2..., apart by commas or spaces; the rest are 0.
+		//The derivative is the one along X_1
 		CString StringVar;
 		VarEdit->GetWindowText(StringVar);
+		StringVar.Replace(_T(','), _T(' '));
 		stringstream trad1;
 		trad1<<(LPCTSTR) StringVar;
+		F<double> Inputs[MAXVARIABLES];
 		double Val;
-		trad1>>Val;	
-		F<double> x = Val;
-		x.diff(0,1);
+		for(COUNTER v=0; v<MAXVARIABLES; v++)
+			Inputs[v] = (trad1>>Val) ? Val : 0.0f;
+		Inputs[0].diff(0,1);
 
-		F<double> Res = DNAStat->Eval(x);
+		F<double> Res = DNAStat->Eval(Inputs);
 		
 
 		StringVar.Format("%f", Res.x());
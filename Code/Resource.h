@@ -26,6 +26,22 @@
 #define IDC_MAXDEPTHX                   1009
 #define IDC_MINDEPTHX                   1010
 #define IDC_TDENSITY                    1011
+#define IDC_TOURNAMENT                  1012
+#define IDC_SEED                        1013
+#define IDC_ISLANDS                     1014
+#define IDC_TOPOLOGY                    1015
+#define IDC_MIGRATE                     1016
+#define IDC_MIGINTERVAL                 1017
+#define IDC_ISLANDPROC                  1018
+#define IDC_STEADY                      1019
+#define IDC_PIPELINED                   1020
+#define IDC_TIMEBUDGET                  1021
+#define IDC_NODEBUDGET                  1022
+#define IDC_CASEBUDGET                  1023
+#define IDC_WORKERS                     1024
+#define IDC_XCOLUMN                     1025
+#define IDC_YCOLUMN                     1026
+#define IDC_STREAMBUDGET                1027
 #define ID_TREEVIEW                     32772
 #define ID_GO                           32773
 #define ID_BUTTON32774                  32774
@@ -38,7 +54,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        132
 #define _APS_NEXT_COMMAND_VALUE         32778
-#define _APS_NEXT_CONTROL_VALUE         1008
+#define _APS_NEXT_CONTROL_VALUE         1028
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
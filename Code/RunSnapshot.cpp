@@ -0,0 +1,106 @@
+#include "StdAfx.h"
+#include "FitnessClass.h"
+#include "DNAStatement.h"
+#include "EvaluatingFunction.h"
+#include ".\runsnapshot.h"
+
+
+/*******************************
+Snapshot Methods
+*******************************/
+CRunSnapshot::CRunSnapshot(const CPopulation& P):
+Generation(P.getGeneration()), Summary(P.Summary), Statistics(P.getStatistics()),
+BestIndex(P.BestIndex), BestSoFar(NULL), VariableCount(1), RangeMin(P.getSettings().RangeMin), RangeMax(P.getSettings().RangeMax){
+
+	try{
+		Individuals.reserve(P.Individuals.size());
+		for(COUNTER i=0; i<P.Individuals.size(); i++)
+			Individuals.push_back(P.Individuals[i] ? new CDNAStatement(*(P.Individuals[i])) : NULL);
+		if(P.getBestSoFar()) BestSoFar = new CDNAStatement(*(P.getBestSoFar()));
+	}
+	catch(...){
+		for(COUNTER i=0; i<Individuals.size(); i++)
+			if(Individuals[i]) delete Individuals[i];
+		throw CString(_T("Could not copy the population at CRunSnapshot::CRunSnapshot\r\n"));
+	}
+
+	if(P.EvalFunc && P.EvalFunc->getCaseCount()){
+		//Cases read from a file may be many and in any order
+		COUNTER Count = P.EvalFunc->getCaseCount();
+		COUNTER Stride = (Count + SNAPSHOTCASES - 1)/SNAPSHOTCASES;
+		const double* const* X = P.EvalFunc->getCasesX();
+		vector< pair<double, COUNTER> > Cases;
+		for(COUNTER i=0; i<Count; i+=Stride)
+			Cases.push_back(make_pair(X[0][i], i));
+		sort(Cases.begin(), Cases.end());
+
+		VariableCount = P.EvalFunc->getVariableCount();
+		for(COUNTER i=0; i<Cases.size(); i++){
+			COUNTER Row = Cases[i].second;
+			CasesX1.push_back(Cases[i].first);
+			CasesY.push_back(P.EvalFunc->getCasesY()[Row]);
+			if(VariableCount > 1)
+				for(COUNTER v=0; v<VariableCount; v++)
+					Inputs.push_back(X[v][Row]);
+		}
+	}
+}
+
+CRunSnapshot::~CRunSnapshot(){
+	for(COUNTER i=0; i<Individuals.size(); i++)
+		if(Individuals[i]) delete Individuals[i];
+	if(BestSoFar) delete BestSoFar;
+}
+
+void CRunSnapshot::drawCases() const{
+	if(CasesX1.size())
+		CEvaluatingFunction::drawPoints(&CasesX1[0], &CasesY[0], (COUNTER)CasesX1.size());
+}
+
+void CRunSnapshot::drawIndividual(CDNAStatement* Individual) const{
+	//Over the range of X_1, or at the cases drawn when there are several inputs
+	if(VariableCount > 1){
+		if(Inputs.size())
+			Individual->drawCases(&Inputs[0], VariableCount, (COUNTER)CasesX1.size());
+	}
+	else Individual->draw(60, RangeMin, RangeMax);
+}
+
+
+/*******************************
+Channel Methods
+*******************************/
+CSnapshotChannel::CSnapshotChannel():
+Latest(NULL), Hazard(NULL){
+}
+
+CSnapshotChannel::~CSnapshotChannel(){
+	for(COUNTER i=0; i<Retired.size(); i++)
+		delete Retired[i];
+	if(Latest) delete Latest;
+}
+
+void CSnapshotChannel::publish(CRunSnapshot* S){
+
+	CRunSnapshot* Old = (CRunSnapshot*)InterlockedExchangePointer((PVOID volatile*)&Latest, S);
+	if(Old) Retired.push_back(Old);
+
+	//The exchange is a full barrier: a reader that announced a retired
+	//snapshot did so before it, or sees the new one when it checks again
+	CRunSnapshot* InUse = Hazard;
+	COUNTER Kept = 0;
+	for(COUNTER i=0; i<Retired.size(); i++)
+		if(Retired[i] == InUse) Retired[Kept++] = Retired[i];
+		else delete Retired[i];
+	Retired.resize(Kept);
+}
+
+const CRunSnapshot* CSnapshotChannel::acquire(){
+
+	CRunSnapshot* S;
+	do{
+		S = Latest;
+		InterlockedExchangePointer((PVOID volatile*)&Hazard, S);
+	}while(S != Latest);
+	return S;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Population.h"
+
+#define SNAPSHOTINTERVAL 100
+//Milliseconds between two looks of the UI at the latest snapshot
+
+#define SNAPSHOTCASES 4096
+//Most fitness cases a snapshot copies to draw, spread evenly over all of them
+
+
+/*******************************
+What viewers see of a run: copies of
+the population and fitness cases taken
+by the engine after a generation. A
+snapshot never changes once published.
+*******************************/
+class CRunSnapshot
+{
+public:
+	COUNTER Generation;
+	CFitnessSummary Summary;
+	CString Statistics;
+	COUNTER BestIndex;
+	vector<CDNAStatement*> Individuals;		//NULL where the population has an empty slot
+	CDNAStatement* BestSoFar;				//of the last generation graded in full, NULL before
+	vector<double> CasesX1;					//sorted on X1, so the cases draw as a curve
+	vector<double> CasesY;
+	COUNTER VariableCount;
+	vector<double> Inputs;					//row by row in the order of CasesX1, with several inputs
+	double RangeMin;
+	double RangeMax;
+
+	CRunSnapshot(const CPopulation& P);
+	~CRunSnapshot();
+
+	void drawCases() const;
+	void drawIndividual(CDNAStatement* Individual) const;
+};
+
+
+/*******************************
+Lock-free hand-over of snapshots from one
+publisher at a time to a single reader.
+Publishing swaps the latest pointer; the
+reader announces the snapshot it holds in
+a hazard pointer, so the publisher frees
+every retired snapshot but that one and
+neither side ever waits on the other.
+*******************************/
+class CSnapshotChannel
+{
+	CRunSnapshot* volatile Latest;
+	CRunSnapshot* volatile Hazard;			//held by the reader until it acquires again
+	vector<CRunSnapshot*> Retired;			//publisher side only
+
+public:
+	CSnapshotChannel();
+	~CSnapshotChannel();					//no thread may use the channel any more
+
+	void publish(CRunSnapshot* S);			//takes ownership
+	const CRunSnapshot* acquire();			//NULL before the first publish
+};
@@ -12,15 +12,29 @@
 IMPLEMENT_DYNAMIC(CSettingsDialog, CDialog)
 CSettingsDialog::CSettingsDialog(CWnd* pParent /*=NULL*/,
 				 COUNTER popCount, COUNTER selectionSize, double mutRate, 
-				 COUNTER maxdepth, COUNTER maxdepthX, COUNTER mindepthX, COUNTER TDensity)
+				 COUNTER maxdepth, COUNTER maxdepthX, COUNTER mindepthX, COUNTER TDensity,
+				 COUNTER TSize, COUNTER Seed,
+				 COUNTER Islands, COUNTER Topo, double MigRate, COUNTER MigInterval,
+				 bool Processes, bool Steady, bool Pipe,
+				 double Seconds, double Nodes, double Cases,
+				 const COUNTER* XCols, COUNTER Variables, COUNTER YCol, COUNTER StreamMB,
+				 COUNTER Workers)
 	: CDialog(CSettingsDialog::IDD, pParent),
 	PopCount(popCount),
 	SelectionSize(selectionSize),
 	MutRate(mutRate),
 	Maxdepth(maxdepth),
 	MaxdepthX(maxdepthX),
-	MindepthX(mindepthX),TreeDensity(TDensity){
+	MindepthX(mindepthX),TreeDensity(TDensity),
+	TournamentSize(TSize), RunSeed(Seed),
+	IslandCount(Islands), Topology(Topo),
+	MigrationRate(MigRate), MigrationInterval(MigInterval),
+	IslandProcesses(Processes), SteadyState(Steady), Pipelined(Pipe),
+	TimeBudget(Seconds), NodeBudget(Nodes), CaseBudget(Cases),
+	VariableCount(Variables), YColumn(YCol), StreamBudget(StreamMB), WorkerCount(Workers){
 
+	for(COUNTER v=0; v<MAXVARIABLES; v++)
+		XColumns[v] = (XCols && (v < Variables)) ? XCols[v] : 0;
 
 }
 
@@ -53,6 +67,22 @@ BOOL CSettingsDialog::OnInitDialog()
 	MaxdepthXEdit = (CEdit*) GetDlgItem(IDC_MAXDEPTHX);
 	MindepthXEdit = (CEdit*) GetDlgItem(IDC_MINDEPTHX);
 	TreeDensityEdit = (CEdit*) GetDlgItem(IDC_TDENSITY);
+	TournamentSizeEdit = (CEdit*) GetDlgItem(IDC_TOURNAMENT);
+	RunSeedEdit = (CEdit*) GetDlgItem(IDC_SEED);
+	IslandCountEdit = (CEdit*) GetDlgItem(IDC_ISLANDS);
+	TopologyEdit = (CEdit*) GetDlgItem(IDC_TOPOLOGY);
+	MigrationRateEdit = (CEdit*) GetDlgItem(IDC_MIGRATE);
+	MigrationIntervalEdit = (CEdit*) GetDlgItem(IDC_MIGINTERVAL);
+	IslandProcessesCheck = (CButton*) GetDlgItem(IDC_ISLANDPROC);
+	SteadyStateCheck = (CButton*) GetDlgItem(IDC_STEADY);
+	PipelinedCheck = (CButton*) GetDlgItem(IDC_PIPELINED);
+	TimeBudgetEdit = (CEdit*) GetDlgItem(IDC_TIMEBUDGET);
+	NodeBudgetEdit = (CEdit*) GetDlgItem(IDC_NODEBUDGET);
+	CaseBudgetEdit = (CEdit*) GetDlgItem(IDC_CASEBUDGET);
+	XColumnsEdit = (CEdit*) GetDlgItem(IDC_XCOLUMN);
+	YColumnEdit = (CEdit*) GetDlgItem(IDC_YCOLUMN);
+	StreamBudgetEdit = (CEdit*) GetDlgItem(IDC_STREAMBUDGET);
+	WorkerCountEdit = (CEdit*) GetDlgItem(IDC_WORKERS);
 
 	CString temp;
 	
@@ -76,6 +106,55 @@ BOOL CSettingsDialog::OnInitDialog()
 
 	temp.Format(_T("%d"), TreeDensity);
 	TreeDensityEdit->SetWindowText(temp);
+
+	temp.Format(_T("%d"), TournamentSize);
+	TournamentSizeEdit->SetWindowText(temp);
+
+	temp.Format(_T("%u"), RunSeed);
+	RunSeedEdit->SetWindowText(temp);
+
+	temp.Format(_T("%d"), IslandCount);
+	IslandCountEdit->SetWindowText(temp);
+
+	temp.Format(_T("%d"), Topology);
+	TopologyEdit->SetWindowText(temp);
+
+	temp.Format(_T("%f"), MigrationRate);
+	MigrationRateEdit->SetWindowText(temp);
+
+	temp.Format(_T("%d"), MigrationInterval);
+	MigrationIntervalEdit->SetWindowText(temp);
+
+	IslandProcessesCheck->SetCheck(IslandProcesses ? BST_CHECKED : BST_UNCHECKED);
+	SteadyStateCheck->SetCheck(SteadyState ? BST_CHECKED : BST_UNCHECKED);
+	PipelinedCheck->SetCheck(Pipelined ? BST_CHECKED : BST_UNCHECKED);
+
+	temp.Format(_T("%g"), TimeBudget);
+	TimeBudgetEdit->SetWindowText(temp);
+
+	temp.Format(_T("%.0f"), NodeBudget);
+	NodeBudgetEdit->SetWindowText(temp);
+
+	temp.Format(_T("%.0f"), CaseBudget);
+	CaseBudgetEdit->SetWindowText(temp);
+
+	//Input columns as a list, X_1 first
+	temp.Empty();
+	for(COUNTER v=0; v<VariableCount; v++){
+		CString Column;
+		Column.Format(v ? _T(", %d") : _T("%d"), XColumns[v]);
+		temp += Column;
+	}
+	XColumnsEdit->SetWindowText(temp);
+
+	temp.Format(_T("%d"), YColumn);
+	YColumnEdit->SetWindowText(temp);
+
+	temp.Format(_T("%d"), StreamBudget);
+	StreamBudgetEdit->SetWindowText(temp);
+
+	temp.Format(_T("%d"), WorkerCount);
+	WorkerCountEdit->SetWindowText(temp);
 	return TRUE; 
 }
 
@@ -119,6 +198,87 @@ void CSettingsDialog::OnBnClickedOk()
 	trad1<<(LPCTSTR) t;
 	trad1>>TreeDensity;
 
+	trad1.clear();
+	TournamentSizeEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>TournamentSize;
+
+	trad1.clear();
+	RunSeedEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>RunSeed;
+
+	trad1.clear();
+	IslandCountEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>IslandCount;
+
+	trad1.clear();
+	TopologyEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>Topology;
+	if(Topology > 2) Topology = 0;
+
+	trad1.clear();
+	MigrationRateEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>MigrationRate;
+
+	trad1.clear();
+	MigrationIntervalEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>MigrationInterval;
+
+	IslandProcesses = (IslandProcessesCheck->GetCheck() == BST_CHECKED);
+	SteadyState = (SteadyStateCheck->GetCheck() == BST_CHECKED);
+	Pipelined = (PipelinedCheck->GetCheck() == BST_CHECKED);
+
+	trad1.clear();
+	TimeBudgetEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>TimeBudget;
+
+	trad1.clear();
+	NodeBudgetEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>NodeBudget;
+
+	trad1.clear();
+	CaseBudgetEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>CaseBudget;
+
+	//Up to MAXVARIABLES input columns, apart by commas or spaces; the old
+	//ones are kept when none is given
+	XColumnsEdit->GetWindowText(t);
+	t.Replace(_T(','), _T(' '));
+	stringstream Columns;
+	Columns<<(LPCTSTR) t;
+	COUNTER Read[MAXVARIABLES];
+	COUNTER ReadCount = 0;
+	while((ReadCount < MAXVARIABLES) && (Columns>>Read[ReadCount]))
+		ReadCount++;
+	if(ReadCount){
+		for(COUNTER v=0; v<ReadCount; v++)
+			XColumns[v] = Read[v];
+		VariableCount = ReadCount;
+	}
+
+	trad1.clear();
+	YColumnEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>YColumn;
+
+	trad1.clear();
+	StreamBudgetEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>StreamBudget;
+
+	trad1.clear();
+	WorkerCountEdit->GetWindowText(t);
+	trad1<<(LPCTSTR) t;
+	trad1>>WorkerCount;
+
 
 	CDialog::OnOK();
 }
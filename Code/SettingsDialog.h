@@ -9,7 +9,9 @@ class CSettingsDialog : public CDialog
 
 public:
 	CSettingsDialog(CWnd* pParent = NULL,
-	COUNTER=50, COUNTER=50, double=0.0, COUNTER=0, COUNTER=0, COUNTER=0,COUNTER=0);   // standard constructor
+	COUNTER=50, COUNTER=50, double=0.0, COUNTER=0, COUNTER=0, COUNTER=0,COUNTER=0,COUNTER=0,COUNTER=0,
+	COUNTER=0, COUNTER=0, double=0.0, COUNTER=0, bool=false, bool=false, bool=false,
+	double=0.0, double=0.0, double=0.0, const COUNTER* =NULL, COUNTER=1, COUNTER=1, COUNTER=0, COUNTER=0);   // standard constructor
 	virtual ~CSettingsDialog();
 
 // Dialog Data
@@ -22,6 +24,23 @@ public:
 	COUNTER	MaxdepthX;
 	COUNTER	MindepthX;
 	COUNTER	TreeDensity;
+	COUNTER	TournamentSize;
+	COUNTER	RunSeed;
+	COUNTER	IslandCount;
+	COUNTER	Topology;
+	double	MigrationRate;
+	COUNTER	MigrationInterval;
+	bool	IslandProcesses;
+	bool	SteadyState;
+	bool	Pipelined;
+	double	TimeBudget;
+	double	NodeBudget;
+	double	CaseBudget;
+	COUNTER	XColumns[MAXVARIABLES];
+	COUNTER	VariableCount;
+	COUNTER	YColumn;
+	COUNTER	StreamBudget;
+	COUNTER	WorkerCount;
 protected:
 	CEdit* PopCountEdit;
 	CEdit* SelectionSizeEdit;
@@ -30,6 +49,22 @@ protected:
 	CEdit* MaxdepthXEdit;
 	CEdit* MindepthXEdit;
 	CEdit* TreeDensityEdit;
+	CEdit* TournamentSizeEdit;
+	CEdit* RunSeedEdit;
+	CEdit* IslandCountEdit;
+	CEdit* TopologyEdit;
+	CEdit* MigrationRateEdit;
+	CEdit* MigrationIntervalEdit;
+	CButton* IslandProcessesCheck;
+	CButton* SteadyStateCheck;
+	CButton* PipelinedCheck;
+	CEdit* TimeBudgetEdit;
+	CEdit* NodeBudgetEdit;
+	CEdit* CaseBudgetEdit;
+	CEdit* XColumnsEdit;
+	CEdit* YColumnEdit;
+	CEdit* StreamBudgetEdit;
+	CEdit* WorkerCountEdit;
 
 	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV support
 
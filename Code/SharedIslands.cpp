@@ -0,0 +1,360 @@
+#include "StdAfx.h"
+#include "FitnessClass.h"
+#include "DNAStatement.h"
+#include "EvaluatingFunction.h"
+#include ".\sharedislands.h"
+
+
+/*******************************
+Admin Methods
+*******************************/
+CSharedIslands::CSharedIslands(const CString& Name, const CRunSettings& R, const CIslandSettings& S):
+Mapping(NULL), Header(NULL){
+
+	open(Name, S.getCount(), true);
+
+	Header->Run = R;
+	Header->Islands = S;
+	Header->TargetGeneration = 0;
+	Header->Stop = 0;
+	for(COUNTER i=0; i<S.getCount(); i++){
+		CSharedInbox& Inbox = getInbox(i);
+		Inbox.Head = Inbox.Tail = Inbox.Dropped = Inbox.Finished = 0;
+		Inbox.Generation = 0;
+		Inbox.BestFitness = INFINITY_GRADE;
+		Inbox.BestSize = 0;
+	}
+}
+
+CSharedIslands::CSharedIslands(const CString& Name):
+Mapping(NULL), Header(NULL){
+
+	//The island count is only known once the header is mapped
+	open(Name, 0, false);
+	COUNTER IslandCount = Header->Islands.getCount();
+	UnmapViewOfFile(Header);
+	CloseHandle(Mapping);
+	Header = NULL;
+	Mapping = NULL;
+
+	open(Name, IslandCount, false);
+}
+
+CSharedIslands::~CSharedIslands(){
+	for(COUNTER i=0; i<Locks.size(); i++)
+		CloseHandle(Locks[i]);
+	if(Header) UnmapViewOfFile(Header);
+	if(Mapping) CloseHandle(Mapping);
+}
+
+void CSharedIslands::open(const CString& Name, COUNTER IslandCount, bool Create){
+
+	DWORD Size = (DWORD)(sizeof(CSharedRun) + IslandCount*sizeof(CSharedInbox));
+	if(Create)
+		Mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, Size, Name);
+	else
+		Mapping = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, Name);
+	if(!Mapping) throw CString(_T("Could not open the island mapping at CSharedIslands::open\r\n"));
+
+	Header = (CSharedRun*)MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, Size);
+	if(!Header){
+		CloseHandle(Mapping);
+		Mapping = NULL;
+		throw CString(_T("Could not map the island inboxes at CSharedIslands::open\r\n"));
+	}
+
+	for(COUNTER i=0; i<IslandCount; i++){
+		CString LockName;
+		LockName.Format("%s.Inbox%d", (LPCTSTR)Name, i);
+		HANDLE L = CreateMutex(NULL, FALSE, LockName);
+		if(!L) throw CString(_T("Could not open an inbox lock at CSharedIslands::open\r\n"));
+		Locks.push_back(L);
+	}
+}
+
+CSharedInbox& CSharedIslands::getInbox(COUNTER Island){
+	return ((CSharedInbox*)(Header + 1))[Island];
+}
+
+void CSharedIslands::lock(COUNTER Island){
+	//An island that died holding the lock leaves it abandoned, not stuck.
+	//Slots are filled before the tail moves, so the ring is still whole.
+	WaitForSingleObject(Locks[Island], INFINITE);
+}
+
+void CSharedIslands::unlock(COUNTER Island){
+	ReleaseMutex(Locks[Island]);
+}
+
+
+/*******************************
+Migration Methods
+*******************************/
+bool CSharedIslands::post(COUNTER To, const CDNAStatement& S){
+
+	vector<unsigned char> Encoded;
+	S.encode(Encoded);
+
+	CSharedInbox& Inbox = getInbox(To);
+	if(Encoded.size() > SHAREDSLOTBYTES){
+		InterlockedIncrement(&Inbox.Dropped);
+		return false;
+	}
+
+	bool Posted = false;
+	lock(To);
+	if(Inbox.Tail - Inbox.Head < SHAREDSLOTCOUNT){
+		COUNTER Slot = (COUNTER)Inbox.Tail % SHAREDSLOTCOUNT;
+		memcpy(Inbox.Slots[Slot], &Encoded[0], Encoded.size());
+		Inbox.Sizes[Slot] = (COUNTER)Encoded.size();
+		Inbox.Tail++;
+		Posted = true;
+	}
+	unlock(To);
+
+	if(!Posted) InterlockedIncrement(&Inbox.Dropped);
+	return Posted;
+}
+
+void CSharedIslands::collect(COUNTER Island, vector<CDNAStatement*>& Arrived, int TreeDensity){
+
+	CSharedInbox& Inbox = getInbox(Island);
+	lock(Island);
+	try{
+		for(; Inbox.Head != Inbox.Tail; Inbox.Head++){
+			COUNTER Slot = (COUNTER)Inbox.Head % SHAREDSLOTCOUNT;
+			const unsigned char* Pos = Inbox.Slots[Slot];
+			Arrived.push_back(CDNAStatement::decode(Pos, Pos + Inbox.Sizes[Slot], TreeDensity));
+		}
+	}
+	catch(CString Err){
+		Inbox.Head = Inbox.Tail;
+		unlock(Island);
+		throw Err;
+	}
+	unlock(Island);
+}
+
+void CSharedIslands::publish(COUNTER Island, COUNTER Generation, double BestFitness){
+	CSharedInbox& Inbox = getInbox(Island);
+	lock(Island);
+	Inbox.Generation = Generation;
+	Inbox.BestFitness = BestFitness;
+	unlock(Island);
+}
+
+void CSharedIslands::publishBest(COUNTER Island, const CDNAStatement& S){
+
+	vector<unsigned char> Encoded;
+	S.encode(Encoded);
+	if(Encoded.size() > SHAREDSLOTBYTES) return;
+
+	CSharedInbox& Inbox = getInbox(Island);
+	lock(Island);
+	memcpy(Inbox.Best, &Encoded[0], Encoded.size());
+	Inbox.BestSize = (COUNTER)Encoded.size();
+	unlock(Island);
+}
+
+void CSharedIslands::readProgress(COUNTER Island, COUNTER& Generation, double& BestFitness){
+	CSharedInbox& Inbox = getInbox(Island);
+	lock(Island);
+	Generation = Inbox.Generation;
+	BestFitness = Inbox.BestFitness;
+	unlock(Island);
+}
+
+CDNAStatement* CSharedIslands::readBest(COUNTER Island, int TreeDensity){
+
+	CSharedInbox& Inbox = getInbox(Island);
+	CDNAStatement* Best = NULL;
+	lock(Island);
+	try{
+		if(Inbox.BestSize){
+			const unsigned char* Pos = Inbox.Best;
+			Best = CDNAStatement::decode(Pos, Pos + Inbox.BestSize, TreeDensity);
+		}
+	}
+	catch(CString Err){
+		unlock(Island);
+		throw Err;
+	}
+	unlock(Island);
+	return Best;
+}
+
+
+/*******************************
+Process Island Model
+*******************************/
+CProcessIslandModel::CProcessIslandModel(const CRunSettings& R, const CIslandSettings& S):
+Shared(NULL){
+
+	if(S.getCount() > MAXISLANDPROCESSES){
+		CString Msg;
+		Msg.Format("At most %d island processes at CProcessIslandModel construction\r\n", MAXISLANDPROCESSES);
+		throw Msg;
+	}
+
+	//Unique to this run of this process
+	static volatile LONG Runs = 0;
+	Name.Format("SymbolRegress.Islands.%u.%d", GetCurrentProcessId(), InterlockedIncrement(&Runs));
+	Shared = new CSharedIslands(Name, R, S);
+}
+
+CProcessIslandModel::~CProcessIslandModel(){
+	stop();
+	if(!Processes.empty())
+		WaitForMultipleObjects((DWORD)Processes.size(), &Processes[0], TRUE, INFINITE);
+	closeProcesses();
+	delete Shared;
+}
+
+void CProcessIslandModel::closeProcesses(){
+	for(COUNTER i=0; i<Processes.size(); i++)
+		CloseHandle(Processes[i]);
+	Processes.clear();
+}
+
+void CProcessIslandModel::start(COUNTER Generations){
+
+	if(!Processes.empty()) throw CString(_T("Islands are still running at CProcessIslandModel::start\r\n"));
+
+	CSharedRun& Run = Shared->getRun();
+	Run.TargetGeneration = Generations;
+	Run.Stop = 0;
+
+	TCHAR Path[MAX_PATH];
+	if(!GetModuleFileName(NULL, Path, MAX_PATH))
+		throw CString(_T("Could not find the executable at CProcessIslandModel::start\r\n"));
+
+	for(COUNTER i=0; i<Run.Islands.getCount(); i++){
+		CString CommandLine;
+		CommandLine.Format("\"%s\" /island %s %d", Path, (LPCTSTR)Name, i);
+
+		STARTUPINFO Startup;
+		PROCESS_INFORMATION Process;
+		ZeroMemory(&Startup, sizeof(Startup));
+		Startup.cb = sizeof(Startup);
+		if(!CreateProcess(NULL, CommandLine.GetBuffer(), NULL, NULL, FALSE,
+			BELOW_NORMAL_PRIORITY_CLASS, NULL, NULL, &Startup, &Process)){
+			CommandLine.ReleaseBuffer();
+			stop();
+			throw CString(_T("Could not start an island process at CProcessIslandModel::start\r\n"));
+		}
+		CommandLine.ReleaseBuffer();
+		CloseHandle(Process.hThread);
+		Processes.push_back(Process.hProcess);
+	}
+}
+
+bool CProcessIslandModel::waitFor(DWORD Milliseconds){
+	if(Processes.empty()) return true;
+	if(WaitForMultipleObjects((DWORD)Processes.size(), &Processes[0], TRUE, Milliseconds) == WAIT_TIMEOUT)
+		return false;
+	closeProcesses();
+	return true;
+}
+
+void CProcessIslandModel::stop(){
+	InterlockedExchange(&Shared->getRun().Stop, 1);
+}
+
+COUNTER CProcessIslandModel::getGeneration() const{
+	COUNTER Slowest = 0;
+	for(COUNTER i=0; i<Shared->getRun().Islands.getCount(); i++){
+		COUNTER Generation;
+		double Best;
+		Shared->readProgress(i, Generation, Best);
+		if(!i || (Generation < Slowest)) Slowest = Generation;
+	}
+	return Slowest;
+}
+
+COUNTER CProcessIslandModel::getFailedCount() const{
+	//Only meaningful once every island process is gone
+	COUNTER Failed = 0;
+	for(COUNTER i=0; i<Shared->getRun().Islands.getCount(); i++)
+		if(!Shared->getInbox(i).Finished) Failed++;
+	return Failed;
+}
+
+CString CProcessIslandModel::getStatistics() const{
+	COUNTER N = Shared->getRun().Islands.getCount();
+	CString Stats;
+	Stats.Format("%d island processes at generation %d, best standardized fitness per island:",
+		N, getGeneration());
+
+	LONG Dropped = 0;
+	for(COUNTER i=0; i<N; i++){
+		COUNTER Generation;
+		double Best;
+		Shared->readProgress(i, Generation, Best);
+		Dropped += Shared->getInbox(i).Dropped;
+
+		CString Island;
+		Island.Format(" %.3f", Best);
+		Stats += Island;
+	}
+	if(Dropped){
+		CString D;
+		D.Format(", %d migrants dropped", Dropped);
+		Stats += D;
+	}
+	return Stats;
+}
+
+void CProcessIslandModel::collectChampions(vector<CDNAStatement*>& Champions){
+	const CSharedRun& Run = Shared->getRun();
+	for(COUNTER i=0; i<Run.Islands.getCount(); i++)
+		if(Shared->getInbox(i).Finished){
+			CDNAStatement* Best = Shared->readBest(i, Run.Run.TreeDensity);
+			if(Best) Champions.push_back(Best);
+		}
+}
+
+int CProcessIslandModel::runIsland(const CString& Name, COUNTER Index){
+
+	try{
+		CSharedIslands Shared(Name);
+		const CSharedRun& Run = Shared.getRun();
+		const CIslandSettings& Settings = Run.Islands;
+		if(Index >= Settings.getCount())
+			throw CString(_T("No such island at CProcessIslandModel::runIsland\r\n"));
+
+		//The process is the island, so batches run inline. Stop cancels
+		//the step under way, as a spent budget does
+		CPopulation P(Run.Run, NULL, NULL, Index);
+		P.EvalFunc->setStop(&Run.Stop);
+		P.setRunning(true);
+
+		vector<CDNAStatement*> Arrived;
+		while(!Run.Stop && P.isRunning() && (P.getGeneration() < Run.TargetGeneration)){
+
+			Shared.collect(Index, Arrived, Run.Run.TreeDensity);
+			P.replaceTail(Arrived);
+
+			P.step();
+			if(!P.isRunning()) break;		//Stop or a spent budget cancelled the step
+			Shared.publish(Index, P.getGeneration(), P.getBestFitness());
+
+			if(Settings.MigrationInterval && !(P.getGeneration() % Settings.MigrationInterval)){
+				vector<COUNTER> Elite = P.getElite(Settings.getMigrantCount((COUNTER)P.Individuals.size()));
+				vector<COUNTER> To = Settings.getNeighbours(Index, P.getGeneration(), Run.Run.RunSeed);
+				for(COUNTER n=0; n<To.size(); n++)
+					for(COUNTER k=0; k<Elite.size(); k++)
+						Shared.post(To[n], *(P.Individuals[Elite[k]]));
+			}
+		}
+
+		vector<COUNTER> Best = P.getElite(1);
+		if(P.getBestSoFar()) Shared.publishBest(Index, *(P.getBestSoFar()));
+		else if(!Best.empty()) Shared.publishBest(Index, *(P.Individuals[Best[0]]));
+		InterlockedExchange(&Shared.getInbox(Index).Finished, 1);
+	}
+	catch(CString){
+		//The parent counts islands that never finished
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "IslandModel.h"
+
+#define SHAREDSLOTCOUNT 64
+//Migrants an island inbox holds; posts to a full inbox are dropped
+
+#define SHAREDSLOTBYTES 2048
+//Largest encoded individual that migrates between processes
+
+#define MAXISLANDPROCESSES MAXIMUM_WAIT_OBJECTS
+//The parent waits on every island process at once
+
+
+/*******************************
+Layout of the named file mapping shared
+by the processes of a run: the run header,
+then one inbox per island. An inbox is a
+ring of encoded individuals guarded by a
+named mutex, so a crashed island abandons
+the mutex instead of locking out the rest.
+*******************************/
+struct CSharedRun{
+	CRunSettings Run;
+	CIslandSettings Islands;
+	COUNTER TargetGeneration;
+	volatile LONG Stop;
+};
+
+struct CSharedInbox{
+	volatile LONG Head;						//next slot the owner reads
+	volatile LONG Tail;						//next slot a sender writes
+	volatile LONG Dropped;
+	volatile LONG Finished;					//the owner exited cleanly
+
+	//Published by the owner, under the inbox mutex
+	COUNTER Generation;
+	double BestFitness;
+	COUNTER BestSize;
+	unsigned char Best[SHAREDSLOTBYTES];
+
+	COUNTER Sizes[SHAREDSLOTCOUNT];
+	unsigned char Slots[SHAREDSLOTCOUNT][SHAREDSLOTBYTES];
+};
+
+
+class CSharedIslands
+{
+	HANDLE Mapping;
+	CSharedRun* Header;
+	vector<HANDLE> Locks;
+
+	void open(const CString& Name, COUNTER IslandCount, bool Create);
+	void lock(COUNTER Island);
+	void unlock(COUNTER Island);
+
+public:
+	CSharedIslands(const CString& Name, const CRunSettings& R, const CIslandSettings& S);	//creates
+	CSharedIslands(const CString& Name);													//opens
+	~CSharedIslands();
+
+	CSharedRun& getRun() { return *Header; };
+	CSharedInbox& getInbox(COUNTER Island);
+
+	bool post(COUNTER To, const CDNAStatement& S);				//false when dropped
+	void collect(COUNTER Island, vector<CDNAStatement*>& Arrived, int TreeDensity);
+	void publish(COUNTER Island, COUNTER Generation, double BestFitness);
+	void publishBest(COUNTER Island, const CDNAStatement& S);
+	void readProgress(COUNTER Island, COUNTER& Generation, double& BestFitness);
+	CDNAStatement* readBest(COUNTER Island, int TreeDensity);	//NULL if none
+};
+
+
+/*******************************
+Island model with every island in its own
+process of this executable, started with
+/island <mapping> <index>. A failed island
+only loses its own population.
+*******************************/
+class CProcessIslandModel : public CIslandRun
+{
+	CString Name;
+	CSharedIslands* Shared;
+	vector<HANDLE> Processes;
+
+	void closeProcesses();
+
+public:
+	CProcessIslandModel(const CRunSettings& R, const CIslandSettings& S);
+	~CProcessIslandModel();
+
+	void start(COUNTER Generations);
+	bool waitFor(DWORD Milliseconds);
+	void stop();
+
+	COUNTER getGeneration() const;
+	COUNTER getFailedCount() const;
+	CString getStatistics() const;
+	void collectChampions(vector<CDNAStatement*>& Champions);	//best of every finished island
+
+	static int runIsland(const CString& Name, COUNTER Index);	//body of an island process
+};
@@ -10,6 +10,10 @@
 #include "SymbolRegressView.h"
 #include "PopulationStringView.h"
 #include "GraphView.h"
+#include "ThreadPool.h"
+#include "SharedIslands.h"
+#include "BatchRun.h"
+#include "CaseTable.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -22,19 +26,71 @@ BEGIN_MESSAGE_MAP(CSymbolRegressApp, CWinApp)
 	ON_COMMAND(ID_APP_ABOUT, OnAppAbout)
 	// Standard file based document commands
 	ON_COMMAND(ID_FILE_NEW, CWinApp::OnFileNew)
-	ON_COMMAND(ID_FILE_OPEN, CWinApp::OnFileOpen)
+	ON_COMMAND(ID_FILE_OPEN, OnFileOpen)
 END_MESSAGE_MAP()
 
 
 // CSymbolRegressApp construction
 
-CSymbolRegressApp::CSymbolRegressApp()
+CSymbolRegressApp::CSymbolRegressApp():
+ExitCode(0)
 {
 	// TODO: add construction code here,
 	// Place all significant initialization in InitInstance
 }
 
 
+// CRegressCommandLineInfo
+
+CRegressCommandLineInfo::CRegressCommandLineInfo():
+IslandArgs(0), BatchArgs(0), ConvertArgs(0), Island(false), IslandIndex(0), Batch(false),
+Convert(false), Float32(false){
+}
+
+void CRegressCommandLineInfo::ParseParam(const TCHAR* pszParam, BOOL bFlag, BOOL bLast)
+{
+	if(bFlag && !_tcsicmp(pszParam, _T("island"))){
+		Island = true;
+		IslandArgs = 2;
+	}
+	else if(IslandArgs == 2){
+		IslandMapping = pszParam;
+		IslandArgs--;
+	}
+	else if(IslandArgs == 1){
+		IslandIndex = (COUNTER)_ttoi(pszParam);
+		IslandArgs--;
+	}
+	else if(bFlag && !_tcsicmp(pszParam, _T("batch"))){
+		Batch = true;
+		BatchArgs = 2;
+	}
+	else if(BatchArgs == 2){
+		BatchSpec = pszParam;
+		BatchArgs--;
+	}
+	else if(BatchArgs == 1){
+		BatchSummary = pszParam;
+		BatchArgs--;
+	}
+	else if(bFlag && !_tcsicmp(pszParam, _T("convert"))){
+		Convert = true;
+		ConvertArgs = 2;
+	}
+	else if(bFlag && !_tcsicmp(pszParam, _T("float32")))
+		Float32 = true;
+	else if(ConvertArgs == 2){
+		ConvertFrom = pszParam;
+		ConvertArgs--;
+	}
+	else if(ConvertArgs == 1){
+		ConvertTo = pszParam;
+		ConvertArgs--;
+	}
+	else CCommandLineInfo::ParseParam(pszParam, bFlag, bLast);
+}
+
+
 // The one and only CSymbolRegressApp object
 
 CSymbolRegressApp theApp;
@@ -50,6 +106,31 @@ BOOL CSymbolRegressApp::InitInstance()
 
 	CWinApp::InitInstance();
 
+	// An island process of a multi-process run evolves and exits, no UI
+	CRegressCommandLineInfo cmdInfo;
+	ParseCommandLine(cmdInfo);
+	if(cmdInfo.Island){
+		CProcessIslandModel::runIsland(cmdInfo.IslandMapping, cmdInfo.IslandIndex);
+		return FALSE;
+	}
+
+	// So does a parameter sweep, which leaves a summary table behind
+	if(cmdInfo.Batch){
+		ExitCode = CBatchRun::runBatch(cmdInfo.BatchSpec, cmdInfo.BatchSummary);
+		return FALSE;
+	}
+
+	// And a conversion of fitness cases to a binary case file
+	if(cmdInfo.Convert){
+		try{
+			AfxMessageBox(CCaseTable::convert(cmdInfo.ConvertFrom, cmdInfo.ConvertTo, cmdInfo.Float32), MB_ICONINFORMATION);
+		}
+		catch(CString Msg){
+			AfxMessageBox(Msg);
+		}
+		return FALSE;
+	}
+
 	// Initialize OLE libraries
 	if (!AfxOleInit())
 	{
@@ -79,7 +160,7 @@ BOOL CSymbolRegressApp::InitInstance()
 	AddDocTemplate(pDocTemplate1);
 
 	//Randomizer initialization
-	srand( (unsigned)time( NULL ) );
+	CRandom::getMain().seed((unsigned __int64)time( NULL ));
 
 	// create main MDI Frame window
 	CMainFrame* pMainFrame = new CMainFrame;
@@ -93,9 +174,6 @@ BOOL CSymbolRegressApp::InitInstance()
 	// Enable DDE Execute open
 	EnableShellOpen();
 	RegisterShellFileTypes(TRUE);
-	// Parse command line for standard shell commands, DDE, file open
-	CCommandLineInfo cmdInfo;
-	ParseCommandLine(cmdInfo);
 	// Dispatch commands specified on the command line.  Will return FALSE if
 	// app was launched with /RegServer, /Register, /Unregserver or /Unregister.
 	if (!ProcessShellCommand(cmdInfo))
@@ -106,6 +184,14 @@ BOOL CSymbolRegressApp::InitInstance()
 	return TRUE;
 }
 
+int CSymbolRegressApp::ExitInstance()
+{
+	//Documents are gone by now, so no batch is left on the pool
+	CThreadPool::destroyShared();
+	int Code = CWinApp::ExitInstance();
+	return ExitCode ? ExitCode : Code;
+}
+
 
 
 // CAboutDlg dialog used for App About
@@ -145,6 +231,15 @@ void CSymbolRegressApp::OnAppAbout()
 	aboutDlg.DoModal();
 }
 
+// Fitness cases open from CSV or binary case files
+void CSymbolRegressApp::OnFileOpen()
+{
+	CFileDialog Dialog(TRUE, _T("csv"), NULL, OFN_HIDEREADONLY | OFN_FILEMUSTEXIST,
+		_T("Fitness Cases (*.csv;*.cases)|*.csv;*.cases|All Files (*.*)|*.*||"));
+	if(Dialog.DoModal() == IDOK)
+		OpenDocumentFile(Dialog.GetPathName());
+}
+
 
 // CSymbolRegressApp message handlers
 
@@ -9,6 +9,40 @@
 #include "resource.h"       // main symbols
 
 
+// CRegressCommandLineInfo:
+// Adds /island <mapping> <index>, which runs one island of a
+// multi-process run without any UI, see SharedIslands.h, and
+// /batch <specification> <summary.csv>, a headless parameter
+// sweep, see BatchRun.h, and /convert <cases.csv> <cases.cases>,
+// which writes a binary case file, float32 after /float32, see
+// CaseTable.h
+//
+
+class CRegressCommandLineInfo : public CCommandLineInfo
+{
+	COUNTER IslandArgs;			//arguments still expected after /island
+	COUNTER BatchArgs;			//and after /batch
+	COUNTER ConvertArgs;		//and after /convert
+
+public:
+	CRegressCommandLineInfo();
+	virtual void ParseParam(const TCHAR* pszParam, BOOL bFlag, BOOL bLast);
+
+	bool Island;
+	CString IslandMapping;
+	COUNTER IslandIndex;
+
+	bool Batch;
+	CString BatchSpec;
+	CString BatchSummary;
+
+	bool Convert;
+	bool Float32;
+	CString ConvertFrom;
+	CString ConvertTo;
+};
+
+
 // CSymbolRegressApp:
 // See SymbolRegress.cpp for the implementation of this class
 //
@@ -22,9 +56,12 @@ public:
 // Overrides
 public:
 	virtual BOOL InitInstance();
+	virtual int ExitInstance();
 
 // Implementation
+	int ExitCode;		//of a headless run, e.g. CBatchRun::runBatch
 	afx_msg void OnAppAbout();
+	afx_msg void OnFileOpen();
 	DECLARE_MESSAGE_MAP()
 };
 
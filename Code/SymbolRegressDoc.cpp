@@ -13,6 +13,9 @@
 #include "FitnessClass.h"
 #include "DNAStatement.h"
 #include "EvaluatingFunction.h"
+#include "CaseTable.h"
+#include "ThreadPool.h"
+#include "SharedIslands.h"
 #include "RegressTreeDlg.h"
 #include "MainFrm.h"
 #include "GraphView.h"
@@ -21,18 +24,18 @@
 
 #ifdef _DEBUG
 
-void CDNAMemPopup(CString M){
+void CDNAMemPopup(CString M, const CFitnessSummary& S){
 	CString F1;
 	F1.Format(	"%d CDNAStatement Objects Currently Allocated\r\n Total ", CDNAStatement::getMem());
 
 	CString F2;
-	F2.Format(	"Total Standardized Fitness %f\r\n", CFitnessClass::getTotalStandardizedFitness());
+	F2.Format(	"Total Standardized Fitness %f\r\n", S.TotalStandardizedFitness);
 
 	CString F3;
-	F3.Format(	"Total Adjusted Fitness %f\r\n", CFitnessClass::getTotalAdjustedFitness());
+	F3.Format(	"Total Adjusted Fitness %f\r\n", S.TotalAdjustedFitness);
 
 	CString F4;
-	F4.Format(	"Total Normalized Fitness %f\r\n", CFitnessClass::getTotalNormalizedFitness());
+	F4.Format(	"Total Normalized Fitness %f\r\n", S.TotalNormalizedFitness);
 
 	M = M + F1 + F2 + F3 + F4;
 	AfxMessageBox(M);
@@ -62,22 +65,27 @@ CSymbolRegressDoc::CSymbolRegressDoc(
 				     COUNTER Popsize, COUNTER SelSize, 
 				     COUNTER maxdeth, COUNTER CMaxDep,
 				     double MProb, COUNTER treeDensity):
-m_FullPopulationSize(Popsize), SelectionSize(SelSize), MaxDepth(maxdeth), 
-CrossMaxDepth(CMaxDep), MutProb(MProb), TreeDensity(treeDensity),
-m_CurrentIndividual(0) , generationCount(0), running(false), m_BestIndex(0),
-EvalFunc(NULL), RangeMin(-1.0f), RangeMax(1.0f), m_CaseCount(60),
-m_Graph(NULL){
+m_CurrentIndividual(0), running(false), m_Cases(NULL), m_Pool(NULL), m_Engine(NULL), m_Snapshot(NULL), m_Graph(NULL),
+m_EngineThread(NULL), m_EvolveTo(0), m_EngineFinished(0), m_Progress(0), m_EngineFailed(false){
+
+	m_Settings.PopulationSize = Popsize;
+	m_Settings.SelectionSize = SelSize;
+	m_Settings.MaxDepth = maxdeth;
+	m_Settings.CrossMaxDepth = CMaxDep;
+	m_Settings.MutProb = MProb;
+	m_Settings.TreeDensity = treeDensity;
 	
 	makePopulation();
-	makeEvaluatingFunction();
 }
 
 CSymbolRegressDoc::~CSymbolRegressDoc(){
+	stopEngine();
 	destroyPopulation();
-	if(EvalFunc) delete EvalFunc;
+	if(m_Pool) delete m_Pool;
+	CCaseTable::release(m_Cases);
 	
 	#ifdef _DEBUG
-		CDNAMemPopup(_T("At ~CSymbolRegressDoc()\r\n"));
+		CDNAMemPopup(_T("At ~CSymbolRegressDoc()\r\n"), CFitnessSummary());
 	#endif
 
 }
@@ -89,6 +97,46 @@ BOOL CSymbolRegressDoc::OnNewDocument()
 	return TRUE;
 }
 
+BOOL CSymbolRegressDoc::OnOpenDocument(LPCTSTR lpszPathName)
+{
+	//The file holds fitness cases, not a saved document
+	if(m_EngineThread){
+		AfxMessageBox(_T("Stop the evolution run before reading fitness cases"));
+		return FALSE;
+	}
+	if(!openCases(lpszPathName, m_Settings.XColumns, m_Settings.VariableCount, m_Settings.YColumn))
+		return FALSE;
+
+	makePopulation();
+	UpdateAllViews(NULL);
+	AfxMessageBox(m_Cases->getReport());
+	return TRUE;
+}
+
+bool CSymbolRegressDoc::openCases(const CString& File, const COUNTER* XColumns, COUNTER VariableCount,
+									COUNTER YColumn){
+	//The run then draws individuals over the range of X_1 read
+	CCaseTable* Cases;
+	try{
+		Cases = CCaseTable::open(File, XColumns, VariableCount, YColumn, m_Settings.StreamBudget > 0);
+	}
+	catch(CString Msg){
+		AfxMessageBox(Msg);
+		return false;
+	}
+	CCaseTable::release(m_Cases);
+	m_Cases = Cases;
+
+	lstrcpyn(m_Settings.DataFile, File, MAX_PATH);
+	for(COUNTER v=0; v<VariableCount; v++)
+		m_Settings.XColumns[v] = XColumns[v];
+	m_Settings.VariableCount = VariableCount;
+	m_Settings.YColumn = YColumn;
+	m_Settings.RangeMin = m_Cases->getXMin();
+	m_Settings.RangeMax = (m_Cases->getXMax() > m_Cases->getXMin()) ? m_Cases->getXMax() : m_Cases->getXMin() + 1.0f;
+	return true;
+}
+
 
 
 
@@ -127,11 +175,15 @@ Make Methods
 
 void CSymbolRegressDoc::makeTreeDialog(){
 
-	if(this->m_Population.size())
-		if(this->m_CurrentIndividual < this->m_Population.size()){
+	if(m_Snapshot && m_Snapshot->Individuals.size())
+		if(this->m_CurrentIndividual < m_Snapshot->Individuals.size()){
 			try{
-				CRegressTreeDlg TreeDlg(NULL, this->m_Population[this->m_CurrentIndividual]);
-				TreeDlg.DoModal();
+				//Snapshots are refreshed while the dialog is up, so it shows a copy
+				if(m_Snapshot->Individuals[this->m_CurrentIndividual]){
+					CDNAStatement Shown(*(m_Snapshot->Individuals[this->m_CurrentIndividual]));
+					CRegressTreeDlg TreeDlg(NULL, &Shown);
+					TreeDlg.DoModal();
+				}
 			}catch(CString Mssg){}
 		}
 		else
@@ -144,224 +196,212 @@ void CSymbolRegressDoc::makeTreeDialog(){
 }
 
 /****************************************
-Evaluation Methods
+Population Methods
 ****************************************/
-void CSymbolRegressDoc::makeEvaluatingFunction(){
+void CSymbolRegressDoc::makePopulation(){
+
+	stopEngine();
+	destroyPopulation();
 	try{
-		EvalFunc = new CEvaluatingFunction(RangeMin, RangeMax);
-		EvalFunc->generatePoints(m_CaseCount);
+		//Batches run on the pool; this document records their progress
+		if(m_Pool) delete m_Pool;
+		m_Pool = NULL;
+		if(m_Settings.WorkerCount) m_Pool = new CThreadPool(m_Settings.WorkerCount);
+		m_Engine = new CPopulation(m_Settings, getPool(), this);
+
+		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->Progress.SetRange(0, (m_Settings.PopulationSize)/10);
+		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->Progress.SetStep(1);
+		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->m_GenerationEdit.SetWindowText(_T("0"));
+
+		publishSnapshot();
+		refreshFromEngine();
 	}
-	catch(CString Mssg){
-		AfxMessageBox(Mssg);
-		EvalFunc = NULL;
+	catch(CString Msg){
+		AfxMessageBox(Msg);
 	}
-}
 
+	#ifdef _DEBUG
+		CDNAMemPopup(_T("At makePopulation()\r\n"), m_Engine ? m_Engine->Summary : CFitnessSummary());
+	#endif
+}
 
-double CSymbolRegressDoc::grade(CDNAStatement* Stat){
-    
-	MSG msg;
-	while(::PeekMessage(&msg, 0, 0, 0, PM_REMOVE)){
+CThreadPool* CSymbolRegressDoc::getPool(){
+	return m_Pool ? m_Pool : CThreadPool::getShared();
+}
 
-		if(!AfxGetApp()->PreTranslateMessage(&msg))
-		{
-			::TranslateMessage(&msg);
-			::DispatchMessage(&msg);
-		}
-	}
-	AfxGetApp()->OnIdle(0);
-	AfxGetApp()->OnIdle(1);
+void CSymbolRegressDoc::destroyPopulation(){
 
-	try{
-		return EvalFunc->EvaluateCDNA(Stat);
-	}
-	catch(CString Mssg){
-		throw Mssg;
-	}
+	if(m_Engine) delete m_Engine;
+	m_Engine = NULL;
+	m_CurrentIndividual = 0;
 }
 
-void CSymbolRegressDoc::EvaluateAll(){
-
-	
-    	((CMainFrame*)(AfxGetApp()->m_pMainWnd))->Progress.SetPos(0);
-	COUNTER i = 0;
-	m_BestIndex = 0;
 
-	try{
-		EvalFunc->generatePoints(m_CaseCount);
-		while ((i < this->m_Population.size())&&(running)){
-			if(i%10 == 0) ((CMainFrame*)(AfxGetApp()->m_pMainWnd))->Progress.StepIt();
-			this->grade(this->m_Population[i]);
-			i++;
-		}
-		for(i=0; i<this->m_Population.size();i++){
-			m_Population[i]->Fitness->normalizeFitness();
-			if(m_Population[i]->Fitness->getNormalizedFitness() > m_Population[m_BestIndex]->Fitness->getNormalizedFitness())
-				m_BestIndex = i;
-		}
-		
-	}
-	catch(CString Mssg){
-		running = false;
-		throw Mssg;		
-	}
+void CSymbolRegressDoc::waiting(COUNTER Done, COUNTER Total){
+	//Called on the engine thread while a batch runs on the pool; the UI picks it up
+	if(Total)
+		InterlockedExchange(&m_Progress, (LONG)((Done*m_Settings.PopulationSize)/Total)/10);
 }
 
+
 /***********************************
-Selection Methods
-******************************/
+Snapshot methods
+************************************/
+void CSymbolRegressDoc::publishSnapshot(){
+	if(m_Engine) m_Snapshots.publish(new CRunSnapshot(*m_Engine));
+}
 
-void CSymbolRegressDoc::Select(){
+void CSymbolRegressDoc::publishSnapshot(COUNTER Generation, const CString& Statistics){
+	//Island runs report their own progress over this document's population
+	if(!m_Engine) return;
+	CRunSnapshot* S = new CRunSnapshot(*m_Engine);
+	S->Generation = Generation;
+	S->Statistics = Statistics;
+	m_Snapshots.publish(S);
+}
 
-	if(SelectionSize > this->m_FullPopulationSize)
-		throw CString(_T("The SelectionSize Facteur must be less than the size of the Population"));
+void CSymbolRegressDoc::refreshFromEngine(){
 
-	vector<CDNAStatement*> NewPopulation;       
+	if(m_EngineThread && m_EngineFinished){
+		StopEvolutionRun();
+		return;
+	}
 
-	int TotFit = (int)CFitnessClass::getTotalNormalizedFitness();
-	if(TotFit < 1) TotFit=1;
-	int ind = 0; 
-	double acc;
+	if(m_EngineThread)
+		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->Progress.SetPos((int)m_Progress);
 
-	
-	//Keep the best one
-	NewPopulation.push_back(new CDNAStatement(*(this->m_Population[this->m_BestIndex])));
-
-	while(NewPopulation.size() < SelectionSize){
-		acc = (double)((rand()%TotFit) + 1);
-		while ((acc - this->m_Population[ind]->Fitness->getNormalizedFitness()) > 0.0){
-			acc -= this->m_Population[ind]->Fitness->getNormalizedFitness();
-			ind = (ind+1)%this->m_Population.size();
-		}
-		NewPopulation.push_back(new CDNAStatement(*(this->m_Population[ind])));
-		
-	}
+	const CRunSnapshot* S = m_Snapshots.acquire();
+	if(!S || (S == m_Snapshot)) return;
 
-	//Clear out Population
-	for(COUNTER i=0; i<this->m_Population.size();i++){
-		if(this->m_Population[i]) {
-			delete this->m_Population[i];
-			this->m_Population[i] = NULL;
-		}
-	}
+	m_Snapshot = S;
+	if(m_CurrentIndividual >= S->Individuals.size()) m_CurrentIndividual = 0;
 
-	for(COUNTER i=0; i<NewPopulation.size(); i++)
-		this->m_Population[i] = NewPopulation[i];
+	CString t;
+	t.Format("%d", S->Generation);
+	((CMainFrame*)(AfxGetApp()->m_pMainWnd))->m_GenerationEdit.SetWindowText(t);
+	((CMainFrame*)(AfxGetApp()->m_pMainWnd))->SetMessageText(S->Statistics);
+	this->UpdateAllViews(NULL);
 }
 
 /***********************************
-Breeding Methods
-***********************************/
-void CSymbolRegressDoc::makePopulation(){
+Steering Wheel methods
+************************************/
+UINT CSymbolRegressDoc::EngineProc(LPVOID Param){
+	((CSymbolRegressDoc*)Param)->runEngine();
+	return 0;
+}
 
-	destroyPopulation();
+void CSymbolRegressDoc::runEngine(){
+	//Never touches a window: the UI thread follows the published snapshots
 	try{
-
-		
-		for(COUNTER i=0; i<this->m_FullPopulationSize; i++){
-			this->m_Population.push_back(new CDNAStatement(UNDEF, TreeDensity));
-			this->m_Population[i]->growCreate(this->MaxDepth);
+		if(m_IslandSettings.IslandCount > 1)
+			runIslands(m_EvolveTo);
+		else{
+			//A stop or a spent budget cancels the step under way, the run
+			//then reports the best of the last generation graded in full
+			m_Engine->setRunning(true);
+			while((m_EvolveTo > m_Engine->getGeneration())&&(running)&&(m_Engine->isRunning())){
+				m_Engine->step();
+				if(running) publishSnapshot();
+			}
 		}
-
-		/*
-		this->m_Population.push_back(new CDNAStatement(*m_Population[0]));
-		this->m_Population[2]->setMutationProb(this->MutProb);
-		this->m_Population[2]->mutate();
-		this->m_Population.push_back(new CDNAStatement(*m_Population[1]));
-		this->m_Population[3]->setMutationProb(this->MutProb);
-		this->m_Population[3]->mutate();
-
-		 this->m_Population.push_back(
-			 &((*(this->m_Population[0]))*(*(this->m_Population[1]))));
-		*/
-
-		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->Progress.SetRange(0, (m_Population.size())/10);
-		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->Progress.SetStep(1);
-		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->m_GenerationEdit.SetWindowText(_T("0"));
+		m_Engine->setRunning(false);
+		publishSnapshot();
 	}
-	catch(CString Msg){
-		AfxMessageBox(Msg);
+	catch (CString Mssg){
+		m_EngineError = Mssg;
+		m_EngineFailed = true;
 	}
+	InterlockedExchange(&m_EngineFinished, 1);
+}
 
-	#ifdef _DEBUG
-		CDNAMemPopup(_T("At makePopulation()\r\n"));
-	#endif
+void CSymbolRegressDoc::stopEngine(){
+	//Joins the engine thread without reporting its run
+	if(!m_EngineThread) return;
+
+	running = false;
+	if(m_Engine && !(m_IslandSettings.IslandCount > 1)) m_Engine->setRunning(false);
+	WaitForSingleObject(m_EngineThread->m_hThread, INFINITE);
+	delete m_EngineThread;
+	m_EngineThread = NULL;
 }
 
-void CSymbolRegressDoc::destroyPopulation(){
+void CSymbolRegressDoc::StopEvolutionRun(){
 
-	generationCount = 0;
-	m_BestIndex = 0;
-	for(COUNTER i=0; i<this->m_Population.size(); i++)
-		if(this->m_Population[i])
-			delete this->m_Population[i];
+	stopEngine();
+	refreshFromEngine();
 
-	this->m_Population.clear();
+	if(m_EngineFailed){
+		AfxMessageBox(m_EngineError);
+		return;
+	}
+	if(!m_EngineNotice.IsEmpty())
+		AfxMessageBox(m_EngineNotice);
+
+	if(m_Snapshot){
+		CString Msg;
+		Msg.Format("Evolution run finished at generation %d\r\nTotal Fitness %f\r\n", 
+			m_Snapshot->Generation, m_Snapshot->Summary.TotalNormalizedFitness);
+		if(m_Snapshot->BestSoFar){
+			CString Best;
+			Best.Format("Best so far %f: ", m_Snapshot->BestSoFar->Fitness->getStandardizedFitness());
+			Msg += Best + m_Snapshot->BestSoFar->toString() + _T("\r\n");
+		}
+		AfxMessageBox(Msg + m_Snapshot->Statistics);
+	}
 }
 
+void CSymbolRegressDoc::runIslands(COUNTER evolveTo){
+	//Every island starts afresh from the run settings
+	if(m_IslandSettings.Processes){
+		//The champion of every island that finished joins this population
+		CProcessIslandModel Model(m_Settings, m_IslandSettings);
+		followIslands(Model, evolveTo);
+
+		vector<CDNAStatement*> Champions;
+		Model.collectChampions(Champions);
+		m_Engine->replaceTail(Champions);
+
+		COUNTER Failed = Model.getFailedCount();
+		if(Failed && running)
+			m_EngineNotice.Format("%d island processes did not finish", Failed);
+		return;
+	}
+
+	//The island holding the best individual becomes this document's population
+	CIslandModel Model(m_Settings, m_IslandSettings);
+	followIslands(Model, evolveTo);
 
-void CSymbolRegressDoc::Breed(){
-
-	COUNTER indMom = 0; 
-        COUNTER indPop = 0;
-        double acc;
-	int TotFit = (int)CFitnessClass::getTotalNormalizedFitness();
-        if(TotFit < 1) TotFit=1;
-
-
-        COUNTER CurrentPopSize = 0;
-        for(COUNTER i=0; i<this->m_Population.size(); i++)
-		if(this->m_Population[i])
-			CurrentPopSize++;
-        
-	COUNTER BegPopSize = CurrentPopSize;
-
-        while(CurrentPopSize < this->m_FullPopulationSize){
-		acc = (double)((rand()%TotFit)+1);
-
-		while ((acc - this->m_Population[indMom]->Fitness->getNormalizedFitness()) > 0.0f){
-			acc -= this->m_Population[indMom]->Fitness->getNormalizedFitness();
-			indMom = rand()%BegPopSize;
-                }
-		
-                
-		m_Population[indMom]->setCrossOverMaxDepth(CrossMaxDepth);
-                m_Population[indPop]->setCrossOverMaxDepth(CrossMaxDepth);
-                m_Population[indPop]->setMutationProb(MutProb);
-
-                this->m_Population[CurrentPopSize]
-                        = &((*(this->m_Population[indPop]))*(*(this->m_Population[indMom])));
-                
-		indPop = (indPop+1)%BegPopSize;
-                CurrentPopSize++;
-        }
+	CPopulation* Best = Model.releaseBestIsland();
+	if(Best){
+		delete m_Engine;
+		m_Engine = Best;
+		m_Engine->attach(getPool(), this);
+	}
 }
 
-/***********************************
-Steering Wheel methods
-************************************/
-void CSymbolRegressDoc::UpdateOnRunIteration(){
-	CString t;
-	t.Format("%d", generationCount);
-	((CMainFrame*)(AfxGetApp()->m_pMainWnd))->m_GenerationEdit.SetWindowText(t);
-	this->UpdateAllViews(NULL);
-}
+void CSymbolRegressDoc::followIslands(CIslandRun& Model, COUNTER evolveTo){
 
-void CSymbolRegressDoc::StopEvolutionRun(){
+	Model.start(evolveTo);
 
-	running = false;
-	EvaluateAll();	
-	CString Msg;
-	Msg.Format("Evolution run finished at generation %d\r\nTotal Fitness %f", 
-		generationCount, CFitnessClass::getTotalNormalizedFitness());
-	AfxMessageBox(Msg);
-	this->UpdateAllViews(NULL);
+	COUNTER Shown = 0;
+	while(!Model.waitFor(PROGRESSINTERVAL)){
+		if(!running) Model.stop();
+
+		COUNTER Generation = Model.getGeneration();
+		if(Generation != Shown){
+			Shown = Generation;
+			publishSnapshot(Generation, Model.getStatistics());
+		}
+	}
 }
 
 void CSymbolRegressDoc::onGo(){
-	if(running){
+	if(!m_Engine) return;
+
+	if(m_EngineThread){
 		CString g;
-		g.Format("already running : current generation %d",  generationCount);
+		g.Format("already running : current generation %d",  m_Snapshot ? m_Snapshot->Generation : 0);
 		AfxMessageBox(g);
 	}
 	else{
@@ -369,50 +409,82 @@ void CSymbolRegressDoc::onGo(){
 		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->m_GenerationEdit.GetWindowText(t);
 		stringstream trad1;
 		trad1<<(LPCTSTR) t;
-		COUNTER evolveTo;
-		running = true;
+		COUNTER evolveTo = 0;
 		trad1>>evolveTo;
-		t.Format("%d", generationCount);
+		t.Format("%d", m_Engine->getGeneration());
 		((CMainFrame*)(AfxGetApp()->m_pMainWnd))->m_GenerationEdit.SetWindowText(t.GetBuffer());
-		
-		try{
-			while((evolveTo > generationCount)&&(running)){
-				EvaluateAll();
-				if(running){
-					Select();
-					Breed();
-					generationCount++;
-					UpdateOnRunIteration();
-				}
-			}
-			StopEvolutionRun();
-		}
-		catch (CString Mssg){
-			AfxMessageBox(Mssg);
+
+		//The main frame's timer reports the run and its end, see refreshFromEngine
+		m_EvolveTo = evolveTo;
+		m_EngineFinished = 0;
+		m_Progress = 0;
+		m_EngineFailed = false;
+		m_EngineError.Empty();
+		m_EngineNotice.Empty();
+		running = true;
+
+		m_EngineThread = AfxBeginThread(EngineProc, this, THREAD_PRIORITY_BELOW_NORMAL, 0, CREATE_SUSPENDED);
+		if(!m_EngineThread){
+			running = false;
+			AfxMessageBox(_T("Could not start the engine thread at CSymbolRegressDoc::onGo\r\n"));
+			return;
 		}
+		m_EngineThread->m_bAutoDelete = FALSE;
+		m_EngineThread->ResumeThread();
 	}
 }
 
 
 void CSymbolRegressDoc::OnStop(){
+	//The engine thread notices within a batch; its end is reported as usual
 	running = false;
+	if(m_EngineThread && m_Engine && !(m_IslandSettings.IslandCount > 1)) m_Engine->setRunning(false);
 }
 
 
 void CSymbolRegressDoc::OnSettings(){
 
-	CSettingsDialog k(NULL, this->m_FullPopulationSize, this->SelectionSize, 
-		this->MutProb, this->MaxDepth,  this->CrossMaxDepth, 0, this->TreeDensity);
+	if(m_EngineThread){
+		AfxMessageBox(_T("Stop the evolution run before changing its settings"));
+		return;
+	}
+
+	CSettingsDialog k(NULL, m_Settings.PopulationSize, m_Settings.SelectionSize, 
+		m_Settings.MutProb, m_Settings.MaxDepth, m_Settings.CrossMaxDepth, 0, m_Settings.TreeDensity,
+		m_Settings.TournamentSize, m_Settings.RunSeed, m_IslandSettings.IslandCount,
+		(COUNTER)m_IslandSettings.Topology, m_IslandSettings.MigrationRate, m_IslandSettings.MigrationInterval,
+		m_IslandSettings.Processes, m_Settings.SteadyState, m_Settings.Pipelined,
+		m_Settings.TimeBudget, m_Settings.NodeBudget, m_Settings.CaseBudget,
+		m_Settings.XColumns, m_Settings.VariableCount, m_Settings.YColumn, m_Settings.StreamBudget,
+		m_Settings.WorkerCount);
 	k.DoModal();
 
-	this->m_FullPopulationSize = k.PopCount;
-	this->SelectionSize = k.SelectionSize;
-	this->MutProb = k.MutRate;
-	this->MaxDepth = k.Maxdepth;
-	this->CrossMaxDepth = k.MaxdepthX;
-	this->TreeDensity = k.TreeDensity;
+	m_Settings.PopulationSize = k.PopCount;
+	m_Settings.SelectionSize = k.SelectionSize;
+	m_Settings.MutProb = k.MutRate;
+	m_Settings.MaxDepth = k.Maxdepth;
+	m_Settings.CrossMaxDepth = k.MaxdepthX;
+	m_Settings.TreeDensity = k.TreeDensity;
+	m_Settings.TournamentSize = k.TournamentSize;
+	m_Settings.RunSeed = k.RunSeed;
+	m_Settings.SteadyState = k.SteadyState;
+	m_Settings.Pipelined = k.Pipelined;
+	m_Settings.TimeBudget = k.TimeBudget;
+	m_Settings.NodeBudget = k.NodeBudget;
+	m_Settings.CaseBudget = k.CaseBudget;
+	m_IslandSettings.IslandCount = k.IslandCount;
+	m_IslandSettings.Topology = (ISLANDTOPOLOGY)k.Topology;
+	m_IslandSettings.MigrationRate = k.MigrationRate;
+	m_IslandSettings.MigrationInterval = k.MigrationInterval;
+	m_IslandSettings.Processes = k.IslandProcesses;
+	bool ColumnsChanged = (k.VariableCount != m_Settings.VariableCount) || (k.YColumn != m_Settings.YColumn) ||
+		((k.StreamBudget > 0) != (m_Settings.StreamBudget > 0));
+	for(COUNTER v=0; (v<k.VariableCount)&&(!ColumnsChanged); v++)
+		ColumnsChanged = (k.XColumns[v] != m_Settings.XColumns[v]);
+	m_Settings.StreamBudget = k.StreamBudget;
+	m_Settings.WorkerCount = k.WorkerCount;
+	if(m_Cases && ColumnsChanged)
+		openCases(m_Settings.DataFile, k.XColumns, k.VariableCount, k.YColumn);
 	this->makePopulation();
 	this->UpdateAllViews(NULL);
 }
-
-
@@ -2,12 +2,15 @@
 //
 #pragma once
 
+#include "Population.h"
+#include "IslandModel.h"
+#include "RunSnapshot.h"
 
 class CDNAStatement;
-class CEvaluatingFunction;
+class CCaseTable;
 class GraphView;
 
-class CSymbolRegressDoc : public CDocument
+class CSymbolRegressDoc : public CDocument, public CRunObserver
 {
 protected: // create from serialization only
 	CSymbolRegressDoc(COUNTER Popsize = 300, COUNTER Selsize=60, 
@@ -16,45 +19,56 @@ protected: // create from serialization only
 
 	
 	
-	COUNTER m_CaseCount;
-	void makeEvaluatingFunction();
-	double grade(CDNAStatement* Stat);
-	void EvaluateAll();
+	CRunSettings m_Settings;
+	CIslandSettings m_IslandSettings;
 
-	COUNTER SelectionSize;
-	void Select();
+	//Held while the document names it, so each new population finds it read
+	CCaseTable* m_Cases;
+	bool openCases(const CString& File, const COUNTER* XColumns, COUNTER VariableCount, COUNTER YColumn);
 
+	void waiting(COUNTER Done, COUNTER Total);
 
-	COUNTER m_FullPopulationSize;
-	COUNTER CrossMaxDepth;
-	double MutProb;
 	void makePopulation();
 	void destroyPopulation();
-	void Breed();
-	
-	COUNTER MaxDepth;
-	COUNTER TreeDensity;
-	
-	
 
-	COUNTER generationCount;
-	bool running;
-	void UpdateOnRunIteration();
+	//Of this document's runs when their settings ask for a worker count
+	CThreadPool* m_Pool;
+	CThreadPool* getPool();
+	void runIslands(COUNTER evolveTo);
+	void followIslands(CIslandRun& Model, COUNTER evolveTo);
+
+	//The engine thread owns m_Engine while it runs; the UI only reads snapshots
+	CWinThread* m_EngineThread;
+	COUNTER m_EvolveTo;
+	volatile bool running;
+	volatile LONG m_EngineFinished;
+	volatile LONG m_Progress;
+	CString m_EngineError;
+	CString m_EngineNotice;
+	bool m_EngineFailed;
+
+	static UINT EngineProc(LPVOID Param);
+	void runEngine();
+	void stopEngine();
 	void StopEvolutionRun();
 
+	CSnapshotChannel m_Snapshots;
+	void publishSnapshot(COUNTER Generation, const CString& Statistics);
+	void publishSnapshot();
+
 public:
-	vector<CDNAStatement*> m_Population;
+	CPopulation* m_Engine;			//NULL if the population could not be made
+	const CRunSnapshot* m_Snapshot;	//what the views show, NULL before the first one
 	COUNTER m_CurrentIndividual;
-	COUNTER m_BestIndex;
-	CEvaluatingFunction* EvalFunc; 	
-	double RangeMin;
-	double RangeMax;
+
+	void refreshFromEngine();		//on the UI thread, at its own rate
 
 	GraphView* m_Graph;
 	void UpdateGraph();
 
 public:
 	virtual BOOL OnNewDocument();
+	virtual BOOL OnOpenDocument(LPCTSTR lpszPathName);
 	virtual void Serialize(CArchive& ar);
 
 // Implementation
@@ -0,0 +1,321 @@
+#include "StdAfx.h"
+#include ".\threadpool.h"
+
+static __declspec(thread) CThreadPool* CurrentPool = NULL;	//pool the thread works for, if any
+static __declspec(thread) int CurrentWorker = -1;			//index of the thread in CurrentPool
+static __declspec(thread) int CurrentNode = -1;
+static __declspec(thread) int TaskDepth = 0;		//tasks run by helping inside a task are not timed twice
+static CThreadPool* SharedPool = NULL;
+
+typedef BOOL (WINAPI *NUMAHIGHESTNODE)(PULONG);
+typedef BOOL (WINAPI *NUMANODEMASK)(UCHAR, PULONGLONG);
+
+static vector<ULONGLONG> detectNodes(){
+	//Processor mask of every NUMA node, or none on a single node. The calls
+	//only exist from Windows Server 2003 on, so they are looked up at run time.
+	vector<ULONGLONG> Masks;
+	HMODULE Kernel = GetModuleHandle(_T("kernel32.dll"));
+	if(!Kernel) return Masks;
+
+	NUMAHIGHESTNODE Highest = (NUMAHIGHESTNODE)GetProcAddress(Kernel, "GetNumaHighestNodeNumber");
+	NUMANODEMASK NodeMask = (NUMANODEMASK)GetProcAddress(Kernel, "GetNumaNodeProcessorMask");
+	ULONG Last = 0;
+	if(!Highest || !NodeMask || !Highest(&Last)) return Masks;
+
+	for(ULONG n=0; (n<=Last) && (Masks.size() < MAXNUMANODES); n++){
+		ULONGLONG Mask = 0;
+		if(NodeMask((UCHAR)n, &Mask) && Mask) Masks.push_back(Mask);
+	}
+	if(Masks.size() < 2) Masks.clear();
+	return Masks;
+}
+
+
+/*******************************
+Pool Admin
+*******************************/
+CThreadPool::CThreadPool(COUNTER WorkerCount):
+Available(0, LONG_MAX), NextQueue(0), Stopping(0), HomedTasks(0), CrossNodeTasks(0){
+
+	if(!WorkerCount) WorkerCount = getProcessorCount();
+
+	//Workers are cut into one run per node, each pinned to its node's processors
+	vector<ULONGLONG> Masks = detectNodes();
+	COUNTER NodeCount = Masks.size() ? (COUNTER)Masks.size() : 1;
+	if(NodeCount > WorkerCount) NodeCount = WorkerCount;
+	NodeWorkers.resize(NodeCount);
+
+	for(COUNTER i=0; i<WorkerCount; i++){
+		CWorker* W = new CWorker();
+		W->Pool = this;
+		W->Index = i;
+		W->Node = (COUNTER)(((unsigned __int64)i*NodeCount)/WorkerCount);
+		W->Thread = NULL;
+		W->BusyTicks = 0;
+		Workers.push_back(W);
+		NodeWorkers[W->Node].push_back(i);
+	}
+
+	//Threads start once every deque exists, since they steal from all of them
+	for(COUNTER i=0; i<WorkerCount; i++){
+		Workers[i]->Thread = AfxBeginThread(WorkerProc, Workers[i], THREAD_PRIORITY_BELOW_NORMAL, 0, CREATE_SUSPENDED);
+		if(!Workers[i]->Thread) throw CString(_T("Could not start a worker thread at CThreadPool construction\r\n"));
+		Workers[i]->Thread->m_bAutoDelete = FALSE;
+		if(NodeCount > 1) SetThreadAffinityMask(Workers[i]->Thread->m_hThread, (DWORD_PTR)Masks[Workers[i]->Node]);
+		Workers[i]->Thread->ResumeThread();
+	}
+}
+
+CThreadPool::~CThreadPool(){
+
+	InterlockedExchange(&Stopping, 1);
+	Available.Unlock((LONG)Workers.size());
+
+	for(COUNTER i=0; i<Workers.size(); i++){
+		if(Workers[i]->Thread){
+			WaitForSingleObject(Workers[i]->Thread->m_hThread, INFINITE);
+			delete Workers[i]->Thread;
+		}
+		delete Workers[i];
+	}
+	Workers.clear();
+}
+
+COUNTER CThreadPool::getProcessorCount(){
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	return Info.dwNumberOfProcessors ? (COUNTER)Info.dwNumberOfProcessors : 1;
+}
+
+int CThreadPool::getCurrentWorker(const CThreadPool* Of){
+	//A worker of one pool may submit to another, where its index means nothing
+	if(Of && (Of != CurrentPool)) return -1;
+	return CurrentWorker;
+}
+
+int CThreadPool::getCurrentNode(const CThreadPool* Of){
+	if(Of && (Of != CurrentPool)) return -1;
+	return CurrentNode;
+}
+
+unsigned __int64 CThreadPool::getBusyTicks(COUNTER Worker){
+	CWorker* W = Workers[Worker];
+	W->Lock.Lock();
+	unsigned __int64 Busy = W->BusyTicks;
+	W->Lock.Unlock();
+	return Busy;
+}
+
+unsigned __int64 CThreadPool::getTicks(){
+	LARGE_INTEGER Now;
+	if(!QueryPerformanceCounter(&Now)) return (unsigned __int64)GetTickCount();
+	return (unsigned __int64)Now.QuadPart;
+}
+
+unsigned __int64 CThreadPool::getTickFrequency(){
+	LARGE_INTEGER Frequency;
+	if(!QueryPerformanceFrequency(&Frequency) || !Frequency.QuadPart) return 1000;
+	return (unsigned __int64)Frequency.QuadPart;
+}
+
+CThreadPool* CThreadPool::getShared(){
+	//Created on first use from the UI thread, destroyed by the application on exit
+	if(!SharedPool) SharedPool = new CThreadPool();
+	return SharedPool;
+}
+
+void CThreadPool::destroyShared(){
+	if(SharedPool) delete SharedPool;
+	SharedPool = NULL;
+}
+
+
+/*******************************
+Scheduling Methods
+*******************************/
+void CThreadPool::submit(CPoolTask* Task, CTaskGroup* Group, int Node){
+
+	CQueued Q;
+	Q.Task = Task;
+	Q.Group = Group;
+	Q.Node = (NodeWorkers.size() > 1) ? Node : -1;
+	if(Q.Node >= (int)NodeWorkers.size()) Q.Node %= (int)NodeWorkers.size();
+
+	//Workers push onto their own deque unless the task belongs to another node;
+	//other tasks are spread round robin over the workers of their node
+	COUNTER Target;
+	int Worker = getCurrentWorker(this);
+	if((Worker >= 0) && ((Q.Node < 0) || (Workers[Worker]->Node == (COUNTER)Q.Node)))
+		Target = (COUNTER)Worker;
+	else if(Q.Node >= 0){
+		const vector<COUNTER>& On = NodeWorkers[Q.Node];
+		Target = On[(COUNTER)InterlockedIncrement(&NextQueue) % On.size()];
+	}
+	else
+		Target = (COUNTER)InterlockedIncrement(&NextQueue) % Workers.size();
+
+	CWorker* W = Workers[Target];
+	W->Lock.Lock();
+	W->Tasks.push_back(Q);
+	W->Lock.Unlock();
+
+	Available.Unlock();
+}
+
+bool CThreadPool::take(int Worker, CQueued& Q){
+	//Own deque from the back (newest), others from the front (oldest)
+	COUNTER N = (COUNTER)Workers.size();
+
+	if(Worker >= 0){
+		CWorker* W = Workers[Worker];
+		W->Lock.Lock();
+		if(!W->Tasks.empty()){
+			Q = W->Tasks.back();
+			W->Tasks.pop_back();
+			W->Lock.Unlock();
+			return true;
+		}
+		W->Lock.Unlock();
+	}
+
+	//Workers of the same node are robbed first, the rest only when they are dry
+	COUNTER First = (Worker >= 0) ? (COUNTER)Worker + 1 : 0;
+	COUNTER Passes = ((Worker >= 0) && (NodeWorkers.size() > 1)) ? 2 : 1;
+	for(COUNTER Pass=0; Pass<Passes; Pass++)
+		for(COUNTER k=0; k<N; k++){
+			CWorker* V = Workers[(First + k) % N];
+			if((Passes > 1) && ((V->Node == Workers[Worker]->Node) != (Pass == 0))) continue;
+			if(V->Tasks.empty()) continue;		//racy peek, rechecked under the lock
+
+			V->Lock.Lock();
+			if(!V->Tasks.empty()){
+				Q = V->Tasks.front();
+				V->Tasks.pop_front();
+				V->Lock.Unlock();
+				return true;
+			}
+			V->Lock.Unlock();
+		}
+	return false;
+}
+
+void CThreadPool::execute(const CQueued& Q, COUNTER Worker){
+	if(Q.Node >= 0){
+		InterlockedIncrement(&HomedTasks);
+		if(Workers[Worker]->Node != (COUNTER)Q.Node) InterlockedIncrement(&CrossNodeTasks);
+	}
+
+	bool Outer = !TaskDepth;
+	unsigned __int64 Start = Outer ? getTicks() : 0;
+	TaskDepth++;
+
+	try{
+		Q.Task->run(Worker);
+	}
+	catch(CString Mess){
+		Q.Group->taskFailed(Mess);
+	}
+	catch(...){
+		Q.Group->taskFailed(CString(_T("Unknown exception in a pool task")));
+	}
+
+	TaskDepth--;
+	if(Outer){
+		unsigned __int64 Spent = getTicks() - Start;
+		CWorker* W = Workers[Worker];
+		W->Lock.Lock();
+		W->BusyTicks += Spent;
+		W->Lock.Unlock();
+	}
+	Q.Group->taskDone();
+}
+
+bool CThreadPool::helpOnce(){
+	//Runs one queued task on the calling worker of this pool, if one is left
+	int Worker = getCurrentWorker(this);
+	if(Worker < 0) return false;
+	if(WaitForSingleObject(Available.m_hObject, 0) != WAIT_OBJECT_0) return false;
+
+	CQueued Q;
+	while(!take(Worker, Q));
+	execute(Q, (COUNTER)Worker);
+	return true;
+}
+
+UINT CThreadPool::WorkerProc(LPVOID Param){
+
+	CWorker* W = (CWorker*)Param;
+	CThreadPool* Pool = W->Pool;
+	CurrentPool = Pool;
+	CurrentWorker = (int)W->Index;
+	CurrentNode = (Pool->NodeWorkers.size() > 1) ? (int)W->Node : -1;
+
+	for(;;){
+		//Every count of the semaphore stands for a queued task, so a worker
+		//that gets one is sure to find a task in some deque.
+		WaitForSingleObject(Pool->Available.m_hObject, INFINITE);
+		if(Pool->Stopping) break;
+
+		CQueued Q;
+		while(!Pool->take((int)W->Index, Q));
+		Pool->execute(Q, W->Index);
+	}
+	return 0;
+}
+
+
+/*******************************
+Task Group Methods
+*******************************/
+CTaskGroup::CTaskGroup(CThreadPool& P):
+Pool(P), Pending(0), Completed(0), Finished(FALSE, FALSE), HasError(false){
+}
+
+CTaskGroup::~CTaskGroup(){
+	//Tasks still queued would refer to this group
+	ASSERT(!Pending);
+}
+
+void CTaskGroup::run(CPoolTask* Task, int Node){
+	InterlockedIncrement(&Pending);
+	Pool.submit(Task, this, Node);
+}
+
+void CTaskGroup::taskFailed(const CString& Msg){
+	ErrorLock.Lock();
+	if(!HasError){
+		Error = Msg;
+		HasError = true;
+	}
+	ErrorLock.Unlock();
+}
+
+void CTaskGroup::taskDone(){
+	InterlockedIncrement(&Completed);
+	if(!InterlockedDecrement(&Pending)) Finished.SetEvent();
+}
+
+bool CTaskGroup::waitFor(DWORD Milliseconds){
+	//Throws the first exception raised by a task of the group, once all have run
+
+	if(CThreadPool::getCurrentWorker(&Pool) >= 0){
+		//A worker waiting on a nested group of its own pool runs queued tasks
+		//instead of blocking; one of another pool just waits
+		while(Pending && Pool.helpOnce());
+	}
+
+	//The event is auto reset and may be left over from an earlier batch,
+	//so the counter alone decides.
+	if(Pending) WaitForSingleObject(Finished.m_hObject, Milliseconds);
+	if(Pending) return false;
+
+	if(HasError){
+		HasError = false;
+		throw Error;
+	}
+	return true;
+}
+
+void CTaskGroup::wait(){
+	while(!waitFor(50));
+}
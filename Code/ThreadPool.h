@@ -0,0 +1,121 @@
+#pragma once
+
+#define TASKSPERWORKER 4
+//Batches are cut into this many tasks per worker so that idle workers find work to steal
+
+#define PROGRESSINTERVAL 50
+//Milliseconds between progress updates while the UI thread waits on the pool
+
+#define MAXNUMANODES 16
+//NUMA nodes the pool places workers on; further nodes are left alone
+
+class CTaskGroup;
+
+/*******************************
+Unit of work run by the pool.
+A CString thrown by run() is handed
+back to whoever waits on its group.
+*******************************/
+class CPoolTask
+{
+public:
+	virtual ~CPoolTask(){};
+	virtual void run(COUNTER Worker) = 0;
+};
+
+
+/*******************************
+Work-stealing thread pool: one worker
+per processor, each with its own deque.
+A worker runs its newest task first and,
+when idle, steals the oldest task of
+another worker, on its own NUMA node
+before any other.
+*******************************/
+class CThreadPool
+{
+	struct CQueued{
+		CPoolTask* Task;
+		CTaskGroup* Group;
+		int Node;				//home node of the task, -1 for any
+	};
+	struct CWorker{
+		CThreadPool* Pool;
+		COUNTER Index;
+		COUNTER Node;
+		CWinThread* Thread;
+		CCriticalSection Lock;
+		deque<CQueued> Tasks;
+		unsigned __int64 BusyTicks;		//running tasks, under Lock
+	};
+
+	vector<CWorker*> Workers;
+	vector< vector<COUNTER> > NodeWorkers;		//workers pinned to each node
+	CSemaphore Available;		//one count per queued task
+	volatile LONG NextQueue;
+	volatile LONG Stopping;
+
+	//Tasks with a home node, and those of them run by a worker of another node
+	volatile LONG HomedTasks;
+	volatile LONG CrossNodeTasks;
+
+	static UINT WorkerProc(LPVOID Param);
+	bool take(int Worker, CQueued& Q);
+	void execute(const CQueued& Q, COUNTER Worker);
+
+	friend class CTaskGroup;
+	void submit(CPoolTask* Task, CTaskGroup* Group, int Node);
+	bool helpOnce();
+
+public:
+	CThreadPool(COUNTER WorkerCount = 0);		//0: one worker per processor
+	~CThreadPool();
+
+	COUNTER getWorkerCount() const { return (COUNTER)Workers.size(); };
+	static int getCurrentWorker(const CThreadPool* Of = NULL);	//-1 outside Of, or outside every pool if NULL
+
+	COUNTER getNodeCount() const { return (COUNTER)NodeWorkers.size(); };
+	static int getCurrentNode(const CThreadPool* Of = NULL);	//as above, and -1 on a single node
+	COUNTER getHomedTasks() const { return (COUNTER)HomedTasks; };
+	COUNTER getCrossNodeTasks() const { return (COUNTER)CrossNodeTasks; };
+
+	//Time a worker has spent in tasks since the pool started
+	unsigned __int64 getBusyTicks(COUNTER Worker);
+	static unsigned __int64 getTicks();
+	static unsigned __int64 getTickFrequency();
+
+	static COUNTER getProcessorCount();
+	static CThreadPool* getShared();
+	static void destroyShared();
+};
+
+
+/*******************************
+A batch of tasks that is waited on
+as a whole. Tasks are owned by the
+caller and must outlive the wait.
+*******************************/
+class CTaskGroup
+{
+	CThreadPool& Pool;
+	volatile LONG Pending;
+	volatile LONG Completed;
+	CEvent Finished;
+	CCriticalSection ErrorLock;
+	CString Error;
+	bool HasError;
+
+	friend class CThreadPool;
+	void taskDone();
+	void taskFailed(const CString& Msg);
+
+public:
+	CTaskGroup(CThreadPool& P);
+	~CTaskGroup();
+
+	void run(CPoolTask* Task, int Node = -1);		//queued on a worker of Node when given
+	bool waitFor(DWORD Milliseconds);			//true once every task has run
+	void wait();
+
+	COUNTER getCompleted() const { return (COUNTER)Completed; };
+};
@@ -41,13 +41,19 @@
 #endif // _AFX_NO_AFXCMN_SUPPORT
 
 #include <afxcview.h>
+#include <afxmt.h>			// MFC synchronization objects
 
 #include <vector>
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <limits>
 #include <sstream>
 using namespace std;
 
 #include <math.h>
 #include <stdlib.h>
+#include <malloc.h>
 #include <stdio.h>
 #include <time.h>
 #include "gl/gl.h"